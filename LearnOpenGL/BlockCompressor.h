@@ -0,0 +1,281 @@
+#pragma once
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include "./MipGenerator.h"
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define BLOCK_COMPRESSOR_X86 1
+#include <emmintrin.h>
+#endif
+
+enum class BlockFormat {
+	BC1, // DXT1, 8 bytes per 4x4 block, opaque RGB
+	BC3, // DXT5, 16 bytes per 4x4 block, RGB + separately coded alpha
+};
+
+struct CompressedLevel {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> blocks;
+};
+
+// a block compressed image with its whole mip chain, ready for glCompressedTexImage2D
+struct CompressedImage {
+	BlockFormat format = BlockFormat::BC1;
+	int channels = 0;      // of the image it was encoded from
+	double encodeMs = 0.0; // wall time spent in BlockCompressor::compress()
+	std::vector<CompressedLevel> levels;
+
+	size_t compressedBytes() const {
+		size_t bytes = 0;
+		for (const CompressedLevel& level : levels) {
+			bytes += level.blocks.size();
+		}
+		return bytes;
+	}
+	// what the same chain would take uncompressed (RGB8/RGBA8)
+	size_t uncompressedBytes() const {
+		size_t bytes = 0;
+		for (const CompressedLevel& level : levels) {
+			bytes += (size_t)level.width * level.height * channels;
+		}
+		return bytes;
+	}
+	size_t basePixels() const {
+		return levels.empty() ? 0 : (size_t)levels[0].width * levels[0].height;
+	}
+};
+
+// encodes 8 bit RGB images to BC1 and RGBA images to BC3 at import time
+// endpoints come from the inset bounding box of each block (SSE2 min/max), every pixel then
+// picks the nearest of the interpolated colors, which is fast and looks close to what offline
+// encoders produce for photos and UI art alike
+// rows of blocks are split over `threads` threads
+class BlockCompressor {
+public:
+	static BlockFormat formatFor(int channels) {
+		return channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+	}
+
+	static size_t blockBytes(BlockFormat format) {
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	// `mips` are levels 1.. of the chain (see MipGenerator), only RGB and RGBA are supported
+	// 0 threads means one per core
+	static CompressedImage compress(const unsigned char* pixels, int width, int height, int channels, const std::vector<MipLevel>& mips, unsigned int threads = 0) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+			threads = threads > 0 ? threads : 1;
+		}
+		CompressedImage image;
+		image.format = formatFor(channels);
+		image.channels = channels;
+		image.levels.push_back(compressLevel(pixels, width, height, channels, image.format, threads));
+		for (const MipLevel& mip : mips) {
+			image.levels.push_back(compressLevel(mip.pixels.data(), mip.width, mip.height, channels, image.format, threads));
+		}
+		image.encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return image;
+	}
+
+	static CompressedLevel compressLevel(const unsigned char* pixels, int width, int height, int channels, BlockFormat format, unsigned int threads) {
+		CompressedLevel level;
+		level.width = width;
+		level.height = height;
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		level.blocks.resize((size_t)blocksX * blocksY * blockBytes(format));
+
+		// small levels aren't worth a thread
+		if (threads > (unsigned int)blocksY) {
+			threads = (unsigned int)blocksY;
+		}
+		if (threads <= 1 || blocksX * blocksY < 256) {
+			compressRows(pixels, width, height, channels, format, 0, blocksY, level.blocks.data());
+			return level;
+		}
+		std::vector<std::thread> workers;
+		int rowsPerThread = (blocksY + (int)threads - 1) / (int)threads;
+		for (int first = 0; first < blocksY; first += rowsPerThread) {
+			int last = first + rowsPerThread < blocksY ? first + rowsPerThread : blocksY;
+			workers.push_back(std::thread(&BlockCompressor::compressRows, pixels, width, height, channels, format, first, last, level.blocks.data()));
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		return level;
+	}
+
+private:
+	static void compressRows(const unsigned char* pixels, int width, int height, int channels, BlockFormat format, int firstRow, int lastRow, unsigned char* out) {
+		int blocksX = (width + 3) / 4;
+		size_t bytesPerBlock = blockBytes(format);
+		alignas(16) unsigned char block[64];
+		for (int by = firstRow; by < lastRow; ++by) {
+			for (int bx = 0; bx < blocksX; ++bx) {
+				loadBlock(pixels, width, height, channels, bx * 4, by * 4, block);
+				unsigned char* destination = out + ((size_t)by * blocksX + bx) * bytesPerBlock;
+				if (format == BlockFormat::BC3) {
+					encodeAlphaBlock(block, destination);
+					encodeColorBlock(block, destination + 8);
+				}
+				else {
+					encodeColorBlock(block, destination);
+				}
+			}
+		}
+	}
+
+	// 4x4 RGBA pixels, edges of images that aren't a multiple of 4 repeat the last row/column
+	static void loadBlock(const unsigned char* pixels, int width, int height, int channels, int x0, int y0, unsigned char* block) {
+		for (int y = 0; y < 4; ++y) {
+			int sy = y0 + y < height ? y0 + y : height - 1;
+			for (int x = 0; x < 4; ++x) {
+				int sx = x0 + x < width ? x0 + x : width - 1;
+				const unsigned char* source = pixels + ((size_t)sy * width + sx) * channels;
+				unsigned char* target = block + (y * 4 + x) * 4;
+				target[0] = source[0];
+				target[1] = source[1];
+				target[2] = source[2];
+				target[3] = channels == 4 ? source[3] : 255;
+			}
+		}
+	}
+
+	// per channel min and max over the 16 pixels
+	static void blockBounds(const unsigned char* block, unsigned char* low, unsigned char* high) {
+#ifdef BLOCK_COMPRESSOR_X86
+		__m128i row0 = _mm_load_si128((const __m128i*)block);
+		__m128i row1 = _mm_load_si128((const __m128i*)(block + 16));
+		__m128i row2 = _mm_load_si128((const __m128i*)(block + 32));
+		__m128i row3 = _mm_load_si128((const __m128i*)(block + 48));
+		__m128i minimum = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+		__m128i maximum = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+		// fold the four pixels of a row into one
+		minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+		minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+		maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+		maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+		int packedMin = _mm_cvtsi128_si32(minimum);
+		int packedMax = _mm_cvtsi128_si32(maximum);
+		std::memcpy(low, &packedMin, 4);
+		std::memcpy(high, &packedMax, 4);
+#else
+		for (int c = 0; c < 4; ++c) {
+			low[c] = 255;
+			high[c] = 0;
+		}
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				unsigned char value = block[i * 4 + c];
+				low[c] = value < low[c] ? value : low[c];
+				high[c] = value > high[c] ? value : high[c];
+			}
+		}
+#endif
+	}
+
+	static uint16_t to565(const unsigned char* color) {
+		return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+	}
+	static void from565(uint16_t packed, int* color) {
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	static void encodeColorBlock(const unsigned char* block, unsigned char* out) {
+		unsigned char low[4], high[4];
+		blockBounds(block, low, high);
+		// pull the endpoints in a little, the extremes are usually outliers
+		for (int c = 0; c < 3; ++c) {
+			int inset = (high[c] - low[c]) >> 4;
+			low[c] = (unsigned char)(low[c] + inset);
+			high[c] = (unsigned char)(high[c] - inset);
+		}
+		uint16_t color0 = to565(high), color1 = to565(low);
+		// color0 > color1 selects the 4 color mode, the 3 color mode would punch holes in opaque blocks
+		if (color0 < color1) {
+			uint16_t swap = color0;
+			color0 = color1;
+			color1 = swap;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			int palette[4][3];
+			from565(color0, palette[0]);
+			from565(color1, palette[1]);
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (int i = 0; i < 16; ++i) {
+				const unsigned char* pixel = block + i * 4;
+				int best = 0, bestDistance = 1 << 30;
+				for (int p = 0; p < 4; ++p) {
+					int dr = pixel[0] - palette[p][0], dg = pixel[1] - palette[p][1], db = pixel[2] - palette[p][2];
+					int distance = dr * dr + dg * dg + db * db;
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (2 * i);
+			}
+		}
+
+		out[0] = (unsigned char)(color0 & 0xFF);
+		out[1] = (unsigned char)(color0 >> 8);
+		out[2] = (unsigned char)(color1 & 0xFF);
+		out[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; ++i) {
+			out[4 + i] = (unsigned char)(indices >> (8 * i));
+		}
+	}
+
+	static void encodeAlphaBlock(const unsigned char* block, unsigned char* out) {
+		unsigned char low[4], high[4];
+		blockBounds(block, low, high);
+		int alpha0 = high[3], alpha1 = low[3];
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1) {
+			// alpha0 > alpha1 selects 6 interpolated values between the endpoints
+			int palette[8] = { alpha0, alpha1 };
+			for (int i = 1; i <= 6; ++i) {
+				palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+			}
+			for (int i = 0; i < 16; ++i) {
+				int alpha = block[i * 4 + 3];
+				int best = 0, bestDistance = 1 << 30;
+				for (int p = 0; p < 8; ++p) {
+					int distance = (alpha - palette[p]) * (alpha - palette[p]);
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= (uint64_t)best << (3 * i);
+			}
+		}
+
+		out[0] = (unsigned char)alpha0;
+		out[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; ++i) {
+			out[2 + i] = (unsigned char)(indices >> (8 * i));
+		}
+	}
+};
+
+#endif
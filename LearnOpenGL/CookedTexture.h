@@ -0,0 +1,375 @@
+#pragma once
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./Texture.h"
+#include "./MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// textures cooked offline into the exact bytes the GL wants: every mip level, already flipped,
+// already in the final (possibly block compressed) format
+// a .lotx file is a header, a table of levels and the level data, each level 16 byte aligned
+// at runtime the file is mapped and the GL reads the levels straight out of the mapping,
+// no decoding, no mip building and no copy of ours in between
+struct CookedTextureHeader {
+	static const unsigned int MAGIC = 0x58544F4C; // "LOTX"
+	static const unsigned int VERSION = 1;
+	// what the file was cooked with, a change means it has to be cooked again
+	static const unsigned int FLIPPED = 1;
+	static const unsigned int SRGB = 2;
+	static const unsigned int MIPMAPPED = 4;
+	static const unsigned int COMPRESS = 8;
+
+	unsigned int magic = MAGIC;
+	unsigned int version = VERSION;
+	GLenum internalFormat = 0; // sized (GL_RGB8, ...) or block compressed (GL_COMPRESSED_RGB_S3TC_DXT1_EXT, ...)
+	GLenum format = 0;         // GL_RED..GL_RGBA for glTexSubImage2D, 0 when block compressed
+	int width = 0;
+	int height = 0;
+	int channels = 0; // of the source image
+	int levelCount = 0;
+	unsigned int flags = 0;
+	unsigned int reserved = 0;
+	long long sourceModified = 0; // stat() of the source image when it was cooked
+	long long sourceSize = 0;
+};
+
+struct CookedTextureLevel {
+	unsigned long long offset = 0; // from the start of the file
+	unsigned long long size = 0;
+	int width = 0;
+	int height = 0;
+};
+
+inline unsigned int cookedTextureFlagsFor(const TextureParams& params) {
+	return (params.flipVertically ? CookedTextureHeader::FLIPPED : 0)
+		| (params.srgb ? CookedTextureHeader::SRGB : 0)
+		| (params.mipmaps ? CookedTextureHeader::MIPMAPPED : 0)
+		| (params.compress ? CookedTextureHeader::COMPRESS : 0);
+}
+
+inline bool isCookedTexturePath(const std::string& path) {
+	return path.size() > 5 && path.compare(path.size() - 5, 5, ".lotx") == 0;
+}
+
+// where cookTextureIfStale() puts the cooked version of `sourcePath`
+inline std::string cookedTexturePath(const std::string& sourcePath, const std::string& directory = "./texture_cache") {
+	std::string name = sourcePath;
+	for (char& c : name) {
+		if (c == '/' || c == '\\' || c == ':') {
+			c = '_';
+		}
+	}
+	return directory + "/" + name + ".lotx";
+}
+
+// a mapped .lotx file, the level pointers stay valid for as long as it's open
+class CookedTexture {
+public:
+	// false (and error() says why) if the file is missing, truncated, from another version or
+	// describes levels the GL would read past the end of, nothing in it is trusted
+	bool open(const std::string& path) {
+		head = nullptr;
+		table = nullptr;
+		if (!file.open(path)) {
+			errorMessage = "can't map " + path;
+			return false;
+		}
+		const unsigned char* bytes = file.data();
+		size_t size = file.size();
+		// the mapping is page aligned, so the header and table can be read in place
+		const CookedTextureHeader* header = (const CookedTextureHeader*)bytes;
+		if (size < sizeof(CookedTextureHeader) || header->magic != CookedTextureHeader::MAGIC || header->version != CookedTextureHeader::VERSION) {
+			errorMessage = path + " is not a version " + std::to_string(CookedTextureHeader::VERSION) + " cooked texture";
+			file.close();
+			return false;
+		}
+		std::string problem = validateHeader(*header);
+		size_t tableEnd = sizeof(CookedTextureHeader) + (size_t)header->levelCount * sizeof(CookedTextureLevel);
+		if (problem.empty() && tableEnd > size) {
+			problem = "is truncated";
+		}
+		const CookedTextureLevel* levels = (const CookedTextureLevel*)(bytes + sizeof(CookedTextureHeader));
+		for (int level = 0; problem.empty() && level < header->levelCount; ++level) {
+			problem = validateLevel(*header, level, levels[level], tableEnd, size);
+		}
+		if (!problem.empty()) {
+			errorMessage = path + " " + problem;
+			file.close();
+			return false;
+		}
+		head = header;
+		table = levels;
+		errorMessage.clear();
+		return true;
+	}
+
+	explicit operator bool() const {
+		return head != nullptr;
+	}
+
+	const CookedTextureHeader& header() const {
+		return *head;
+	}
+	int levelCount() const {
+		return head->levelCount;
+	}
+	const CookedTextureLevel& level(int index) const {
+		return table[index];
+	}
+	const unsigned char* levelData(int index) const {
+		return file.data() + table[index].offset;
+	}
+	bool blockCompressed() const {
+		return head->format == 0;
+	}
+	size_t fileBytes() const {
+		return file.size();
+	}
+
+	// touch every page off the GL thread, see MappedFile::prefault()
+	void prefault() const {
+		file.prefault();
+	}
+
+	const std::string& error() const {
+		return errorMessage;
+	}
+
+private:
+	MappedFile file;
+	const CookedTextureHeader* head = nullptr;
+	const CookedTextureLevel* table = nullptr;
+	std::string errorMessage;
+
+	// empty if the header describes a texture uploadCookedTexture() can make
+	static std::string validateHeader(const CookedTextureHeader& header) {
+		if (header.width <= 0 || header.height <= 0 || header.width > 32768 || header.height > 32768) {
+			return "has a bad size " + std::to_string(header.width) + "x" + std::to_string(header.height);
+		}
+		if (header.channels < 1 || header.channels > 4) {
+			return "has " + std::to_string(header.channels) + " channels";
+		}
+		if (header.levelCount <= 0 || header.levelCount > mipLevelCount(header.width, header.height)) {
+			return "has " + std::to_string(header.levelCount) + " levels";
+		}
+		bool formatMatches = header.format == 0
+			? isCompressedTextureFormat(header.internalFormat)
+			: header.format == textureFormatFor(header.channels)
+				&& header.internalFormat == textureInternalFormatFor(header.channels, (header.flags & CookedTextureHeader::SRGB) != 0);
+		if (!formatMatches) {
+			return "has an unknown format";
+		}
+		return std::string();
+	}
+
+	// empty if the level is exactly as big as what the GL will read for it and lies inside the file
+	static std::string validateLevel(const CookedTextureHeader& header, int index, const CookedTextureLevel& level, size_t tableEnd, size_t fileSize) {
+		int width = header.width >> index > 1 ? header.width >> index : 1;
+		int height = header.height >> index > 1 ? header.height >> index : 1;
+		if (level.width != width || level.height != height) {
+			return "level " + std::to_string(index) + " is " + std::to_string(level.width) + "x" + std::to_string(level.height)
+				+ " instead of " + std::to_string(width) + "x" + std::to_string(height);
+		}
+		unsigned long long expected;
+		if (header.format == 0) {
+			bool dxt1 = header.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || header.internalFormat == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+			expected = (unsigned long long)((width + 3) / 4) * ((height + 3) / 4) * (dxt1 ? 8 : 16);
+		}
+		else {
+			expected = (unsigned long long)width * height * header.channels;
+		}
+		if (level.size != expected) {
+			return "level " + std::to_string(index) + " has " + std::to_string(level.size) + " bytes instead of " + std::to_string(expected);
+		}
+		// compared without adding, so a huge offset or size can't wrap around
+		if (level.offset < tableEnd || level.offset > fileSize || level.size > fileSize - level.offset) {
+			return "is truncated";
+		}
+		return std::string();
+	}
+};
+
+// decodes `sourcePath` with stb_image and writes it to `cookedPath` the way `params` asks for:
+// flipped, with a CPU built mip chain and BC1/BC3 compressed if params.compress
+// (the runtime has to support S3TC then, see canUploadCompressed())
+// doesn't need a GL context, meant for a cook step or the first run
+inline bool cookTexture(const std::string& sourcePath, const std::string& cookedPath, const TextureParams& params) {
+	struct stat source;
+	if (stat(sourcePath.c_str(), &source) != 0) {
+		std::cout << "ERROR::TEXTURE::COOK::SOURCE_NOT_FOUND " << sourcePath << std::endl;
+		return false;
+	}
+	TextureImage image = TextureImage::decode(sourcePath, params.flipVertically);
+	if (!image) {
+		std::cout << "ERROR::TEXTURE::COOK::DECODE_FAILED " << sourcePath << ": " << image.error << std::endl;
+		return false;
+	}
+	if (params.mipmaps) {
+		image.generateMips(params.srgb);
+	}
+	if (params.compress) {
+		image.compress(0); // offline, every core can help
+	}
+
+	CookedTextureHeader header;
+	header.width = image.width;
+	header.height = image.height;
+	header.channels = image.channels;
+	header.flags = cookedTextureFlagsFor(params);
+	header.sourceModified = (long long)source.st_mtime;
+	header.sourceSize = (long long)source.st_size;
+
+	std::vector<const unsigned char*> data;
+	std::vector<CookedTextureLevel> levels;
+	if (!image.compressed.levels.empty()) {
+		header.internalFormat = compressedFormatFor(image.compressed.format, params.srgb);
+		for (const CompressedLevel& blocks : image.compressed.levels) {
+			CookedTextureLevel level;
+			level.width = blocks.width;
+			level.height = blocks.height;
+			level.size = blocks.blocks.size();
+			levels.push_back(level);
+			data.push_back(blocks.blocks.data());
+		}
+	}
+	else {
+		header.internalFormat = textureInternalFormatFor(image.channels, params.srgb);
+		header.format = textureFormatFor(image.channels);
+		CookedTextureLevel base;
+		base.width = image.width;
+		base.height = image.height;
+		base.size = image.byteSize();
+		levels.push_back(base);
+		data.push_back(image.pixels.get());
+		for (const MipLevel& mip : image.mips) {
+			CookedTextureLevel level;
+			level.width = mip.width;
+			level.height = mip.height;
+			level.size = mip.pixels.size();
+			levels.push_back(level);
+			data.push_back(mip.pixels.data());
+		}
+	}
+	header.levelCount = (int)levels.size();
+
+	unsigned long long offset = sizeof(CookedTextureHeader) + levels.size() * sizeof(CookedTextureLevel);
+	for (CookedTextureLevel& level : levels) {
+		offset = (offset + 15) & ~15ull;
+		level.offset = offset;
+		offset += level.size;
+	}
+
+	// written next to the target and renamed over it, so a running loader never maps half a file
+	std::string temporaryPath = cookedPath + ".tmp";
+	FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+	if (!file) {
+		std::cout << "ERROR::TEXTURE::COOK::WRITE_FAILED " << cookedPath << std::endl;
+		return false;
+	}
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& std::fwrite(levels.data(), sizeof(CookedTextureLevel), levels.size(), file) == levels.size();
+	const unsigned char padding[16] = {};
+	unsigned long long written = sizeof(CookedTextureHeader) + levels.size() * sizeof(CookedTextureLevel);
+	for (size_t i = 0; ok && i < levels.size(); ++i) {
+		ok = std::fwrite(padding, 1, (size_t)(levels[i].offset - written), file) == levels[i].offset - written
+			&& std::fwrite(data[i], 1, (size_t)levels[i].size, file) == levels[i].size;
+		written = levels[i].offset + levels[i].size;
+	}
+	ok = std::fclose(file) == 0 && ok;
+	std::remove(cookedPath.c_str()); // rename doesn't replace files on Windows
+	if (!ok || std::rename(temporaryPath.c_str(), cookedPath.c_str()) != 0) {
+		std::cout << "ERROR::TEXTURE::COOK::WRITE_FAILED " << cookedPath << std::endl;
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+// the cooked version of `sourcePath` in `directory`, cooked first if it's missing, older than
+// the source or was cooked with other params
+// returns the path to load: the .lotx file, or `sourcePath` itself if cooking failed, so a cooked
+// file CookedTexture::open() rejects is never handed to the loader
+inline std::string cookTextureIfStale(const std::string& sourcePath, const TextureParams& params, const std::string& directory = "./texture_cache") {
+	std::string cookedPath = cookedTexturePath(sourcePath, directory);
+	struct stat source;
+	if (stat(sourcePath.c_str(), &source) != 0) {
+		// no source to cook from, a cooked file shipped on its own is still fine
+		CookedTexture shipped;
+		if (shipped.open(cookedPath)) {
+			return cookedPath;
+		}
+		return sourcePath;
+	}
+
+	// a file that doesn't validate is cooked again like a stale one, just mapping it is cheap
+	// (scoped, the mapping has to be gone before cookTexture() replaces the file)
+	bool current = false;
+	{
+		CookedTexture cooked;
+		if (cooked.open(cookedPath)) {
+			const CookedTextureHeader& header = cooked.header();
+			current = header.flags == cookedTextureFlagsFor(params)
+				&& header.sourceModified == (long long)source.st_mtime && header.sourceSize == (long long)source.st_size;
+		}
+	}
+	if (current) {
+		return cookedPath;
+	}
+
+	// fails harmlessly when it already exists
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+	if (!cookTexture(sourcePath, cookedPath, params)) {
+		return sourcePath;
+	}
+	CookedTexture cooked;
+	if (!cooked.open(cookedPath)) {
+		std::cout << "ERROR::TEXTURE::COOK::INVALID " << cooked.error() << std::endl;
+		return sourcePath;
+	}
+	return cookedPath;
+}
+
+// creates a texture from a mapped cooked file, must run on the GL thread
+// the level pointers go to the GL as they are, it reads them straight from the page cache
+// params only contribute wrapping and filtering, everything else was decided when cooking
+// returns an empty texture if the file needs S3TC and the context doesn't have it
+inline GLTexture uploadCookedTexture(const CookedTexture& cooked, const TextureParams& params) {
+	const CookedTextureHeader& header = cooked.header();
+	std::vector<const void*> levels;
+	std::vector<GLsizei> levelBytes;
+	for (int level = 0; level < header.levelCount; ++level) {
+		levels.push_back(cooked.levelData(level));
+		levelBytes.push_back((GLsizei)cooked.level(level).size);
+	}
+
+	TextureParams cookedParams = params;
+	cookedParams.srgb = (header.flags & CookedTextureHeader::SRGB) != 0;
+	if (cooked.blockCompressed()) {
+		if (!canUploadCompressed(cookedParams)) {
+			std::cout << "ERROR::TEXTURE::COOKED::S3TC_NOT_SUPPORTED cook it again without compress" << std::endl;
+			return GLTexture();
+		}
+		return uploadCompressedTexture2D(header.internalFormat, header.width, header.height, levels.data(), levelBytes.data(), header.levelCount, cookedParams);
+	}
+	// a single cooked level is all there is, the GL generating more would defeat the point
+	cookedParams.mipmaps = header.levelCount > 1;
+	return uploadTexture2D(header.width, header.height, header.channels, levels.data(), header.levelCount, cookedParams);
+}
+
+#endif
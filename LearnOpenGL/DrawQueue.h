@@ -0,0 +1,227 @@
+#pragma once
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <glad/glad.h>
+#include "./GLStateCache.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+
+// everything one draw needs, resolved to GL names up front so executing it never looks anything up
+struct DrawCommand {
+	static const int MAX_TEXTURES = 4;
+
+	GLuint program = 0;
+	GLuint vertexArray = 0;
+	GLuint textures[MAX_TEXTURES] = {}; // textures[i] goes to unit i, 0 leaves the unit alone
+	GLenum textureTarget = GL_TEXTURE_2D;
+	GLenum mode = GL_TRIANGLES;
+	GLenum indexType = 0;  // 0 draws arrays, else the type of the vertex array's index buffer
+	GLintptr first = 0;    // first vertex, or byte offset into the index buffer
+	GLsizei count = 0;
+	GLsizei instanceCount = 1; // anything but 1 draws instanced
+	// per draw uniforms, called after the program, textures and vertex array are bound
+	void (*setup)(const DrawCommand& command, const void* user) = nullptr;
+	const void* user = nullptr;
+
+	// units past MAX_TEXTURES (or samplerUnit()'s -1 for a sampler the program doesn't use) are ignored
+	void setTexture(int unit, GLuint texture) {
+		if (unit >= 0 && unit < MAX_TEXTURES) {
+			textures[unit] = texture;
+		}
+	}
+};
+
+// 64 bit sort keys, most significant first:
+//   pass (4) | program (12) | material (16) | vertex array (12) | depth (20)
+// so a sorted frame runs pass by pass, switches programs least and textures next to least, and
+// draws front to back within the same state (early z rejects more)
+// the GL names are masked into their fields, names that collide only cost extra switches,
+// the command itself carries the real state
+struct DrawKey {
+	static const int PASS_BITS = 4;
+	static const int PROGRAM_BITS = 12;
+	static const int MATERIAL_BITS = 16;
+	static const int VERTEX_ARRAY_BITS = 12;
+	static const int DEPTH_BITS = 20;
+
+	// depth in 0..1 (clamped), near to far
+	static uint64_t make(unsigned int pass, GLuint program, unsigned int material, GLuint vertexArray, float depth) {
+		return field(pass, PASS_BITS, 60) | field(program, PROGRAM_BITS, 48) | field(material, MATERIAL_BITS, 32)
+			| field(vertexArray, VERTEX_ARRAY_BITS, 20) | quantizeDepth(depth);
+	}
+
+	// for blended passes: far to near comes first, state only groups draws at the same depth
+	//   pass (4) | inverted depth (20) | program (12) | material (16) | vertex array (12)
+	static uint64_t makeBackToFront(unsigned int pass, GLuint program, unsigned int material, GLuint vertexArray, float depth) {
+		uint64_t inverted = ((1u << DEPTH_BITS) - 1) - quantizeDepth(depth);
+		return field(pass, PASS_BITS, 60) | (inverted << 40) | field(program, PROGRAM_BITS, 28)
+			| field(material, MATERIAL_BITS, 12) | field(vertexArray, VERTEX_ARRAY_BITS, 0);
+	}
+
+	// folds a command's texture names into the material field, equal sets get equal ids
+	static unsigned int materialOf(const DrawCommand& command) {
+		uint32_t hash = 2166136261u;
+		for (int unit = 0; unit < DrawCommand::MAX_TEXTURES; ++unit) {
+			hash = (hash ^ command.textures[unit]) * 16777619u;
+		}
+		return (hash ^ (hash >> 16)) & ((1u << MATERIAL_BITS) - 1);
+	}
+
+private:
+	static uint64_t field(uint64_t value, int bits, int shift) {
+		return (value & ((1ull << bits) - 1)) << shift;
+	}
+	static uint64_t quantizeDepth(float depth) {
+		depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+		return (uint64_t)(depth * (float)((1u << DEPTH_BITS) - 1));
+	}
+};
+
+// collects a frame's draws with their sort keys, then runs them in key order through the state
+// cache, so consecutive draws with the same program/textures/vertex array cost only the draw call
+// the sort is an LSD radix sort on the keys (8 bits a pass, passes where every key has the same
+// byte are skipped), linear in the number of draws and stable, equal keys keep submission order
+// storage is kept between frames, a steady frame allocates nothing
+class DrawQueue {
+public:
+	// what the last execute() did
+	struct Stats {
+		unsigned int draws = 0;
+		unsigned int programSwitches = 0;
+		unsigned int textureSwitches = 0; // draws that changed at least one texture
+		unsigned int vertexArraySwitches = 0;
+	};
+
+	void submit(uint64_t key, const DrawCommand& command) {
+		entries.push_back(Entry{ key, (uint32_t)commands.size() });
+		commands.push_back(command);
+	}
+	// keyed from the command's own state
+	void submit(const DrawCommand& command, float depth = 0.0f, unsigned int pass = 0) {
+		submit(DrawKey::make(pass, command.program, DrawKey::materialOf(command), command.vertexArray, depth), command);
+	}
+
+	size_t size() const {
+		return commands.size();
+	}
+
+	// orders the queued draws by key
+	void sort() {
+		const size_t count = entries.size();
+		if (count < 2) {
+			return;
+		}
+		// one read for all eight histograms
+		size_t histograms[8][256] = {};
+		for (const Entry& entry : entries) {
+			for (int digit = 0; digit < 8; ++digit) {
+				histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+			}
+		}
+		scratch.resize(count);
+		for (int digit = 0; digit < 8; ++digit) {
+			size_t* histogram = histograms[digit];
+			// every key has the same byte here, this pass wouldn't move anything
+			if (histogram[(entries[0].key >> (digit * 8)) & 0xFF] == count) {
+				continue;
+			}
+			size_t offset = 0;
+			for (int bucket = 0; bucket < 256; ++bucket) {
+				size_t bucketSize = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketSize;
+			}
+			for (const Entry& entry : entries) {
+				scratch[histogram[(entry.key >> (digit * 8)) & 0xFF]++] = entry;
+			}
+			entries.swap(scratch);
+		}
+	}
+
+	// issues the queued draws in their current order and empties the queue
+	void execute() {
+		stats = Stats();
+		GLuint program = 0, vertexArray = 0;
+		GLuint textures[DrawCommand::MAX_TEXTURES] = {};
+		bool first = true;
+		for (const Entry& entry : entries) {
+			const DrawCommand& command = commands[entry.index];
+			if (first || command.program != program) {
+				stats.programSwitches++;
+				program = command.program;
+			}
+			glState().useProgram(command.program);
+			bool texturesChanged = first;
+			for (int unit = 0; unit < DrawCommand::MAX_TEXTURES; ++unit) {
+				if (command.textures[unit] == 0) {
+					continue;
+				}
+				texturesChanged = texturesChanged || command.textures[unit] != textures[unit];
+				textures[unit] = command.textures[unit];
+				glState().bindTexture((GLuint)unit, command.textureTarget, command.textures[unit]);
+			}
+			if (texturesChanged) {
+				stats.textureSwitches++;
+			}
+			if (first || command.vertexArray != vertexArray) {
+				stats.vertexArraySwitches++;
+				vertexArray = command.vertexArray;
+			}
+			glState().bindVertexArray(command.vertexArray);
+			if (command.setup) {
+				command.setup(command, command.user);
+			}
+			if (command.instanceCount != 1) {
+				if (command.indexType) {
+					glDrawElementsInstanced(command.mode, command.count, command.indexType, (const void*)command.first, command.instanceCount);
+				}
+				else {
+					glDrawArraysInstanced(command.mode, (GLint)command.first, command.count, command.instanceCount);
+				}
+			}
+			else if (command.indexType) {
+				glDrawElements(command.mode, command.count, command.indexType, (const void*)command.first);
+			}
+			else {
+				glDrawArrays(command.mode, (GLint)command.first, command.count);
+			}
+			stats.draws++;
+			first = false;
+		}
+		entries.clear();
+		commands.clear();
+	}
+
+	// sort + execute, once per frame (or per pass, if the passes need something in between)
+	void flush() {
+		sort();
+		execute();
+	}
+
+	const Stats& getStats() const {
+		return stats;
+	}
+
+	void printStats() const {
+		std::cout << "Draw queue: " << stats.draws << " draws, " << stats.programSwitches << " program, " << stats.textureSwitches
+			<< " texture and " << stats.vertexArraySwitches << " vertex array switches last frame" << std::endl;
+	}
+
+private:
+	struct Entry {
+		uint64_t key;
+		uint32_t index; // into commands
+	};
+
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;
+	std::vector<DrawCommand> commands;
+	Stats stats;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+#ifndef FRAME_DATA_H
+#define FRAME_DATA_H
+
+#include "./UniformBuffer.h"
+
+// C++ mirror of `uniform FrameData` in frameData.glsl, change both together
+struct FrameData {
+	Std140Vec4 ourColorA;
+	float xOffset;
+	float mixAmt;
+	float time;
+	float padding;
+};
+STD140_ASSERT_OFFSET(FrameData, ourColorA, 0);
+STD140_ASSERT_OFFSET(FrameData, xOffset, 16);
+STD140_ASSERT_OFFSET(FrameData, mixAmt, 20);
+STD140_ASSERT_OFFSET(FrameData, time, 24);
+STD140_ASSERT_SIZE(FrameData, 32);
+
+#endif
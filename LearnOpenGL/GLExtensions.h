@@ -0,0 +1,191 @@
+#pragma once
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+#include "./GLStateCache.h"
+
+#include <cstring>
+
+// our glad loader was generated for core 3.3 with no extensions,
+// anything newer is loaded here by hand when the driver offers it
+// call loadGLExtensions() right after gladLoadGLLoader() succeeds
+
+// ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// KHR_parallel_shader_compile (ARB_parallel_shader_compile has the same enums)
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// ARB_buffer_storage (core in 4.4)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+// ARB_texture_storage (core in 4.2)
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+#endif
+
+// EXT_texture_compression_s3tc (+ EXT_texture_sRGB for the sRGB variants)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+typedef void (APIENTRYP GLEXTGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP GLEXTPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP GLEXTPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP GLEXTMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+typedef void (APIENTRYP GLEXTBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP GLEXTTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP GLEXTTEXSTORAGE3DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+typedef void (APIENTRYP GLEXTMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP GLEXTDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)(GLenum mode, GLsizei count, GLenum type, const void* indices,
+	GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+typedef void (APIENTRYP GLEXTCOPYIMAGESUBDATAPROC)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+	GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+
+struct GLExtensions {
+	bool loaded = false;
+
+	bool programBinary = false;
+	GLEXTGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+	GLEXTPROGRAMBINARYPROC ProgramBinary = nullptr;
+	GLEXTPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+
+	bool parallelShaderCompile = false;
+	GLEXTMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+
+	bool bufferStorage = false;
+	GLEXTBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+	bool textureStorage = false;
+	GLEXTTEXSTORAGE2DPROC TexStorage2D = nullptr;
+	GLEXTTEXSTORAGE3DPROC TexStorage3D = nullptr;
+
+	bool copyImage = false;
+	GLEXTCOPYIMAGESUBDATAPROC CopyImageSubData = nullptr;
+
+	// indirect draws that honor baseInstance, see MeshBatch
+	bool multiDrawIndirect = false;
+	GLEXTMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+
+	bool baseInstance = false;
+	GLEXTDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC DrawElementsInstancedBaseVertexBaseInstance = nullptr;
+
+	// no entry points, glCompressedTexImage2D is core
+	bool textureCompressionS3TC = false;
+	bool textureCompressionS3TCsRGB = false;
+};
+
+// the one set of extension entry points for the current context
+inline GLExtensions& glExt() {
+	static GLExtensions extensions;
+	return extensions;
+}
+
+inline bool hasGLVersion(int major, int minor) {
+	return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+inline bool hasGLExtension(const char* name) {
+	int count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (int i = 0; i < count; ++i) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (extension && std::strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline void loadGLExtensions(GLADloadproc load) {
+	GLExtensions& ext = glExt();
+	ext = GLExtensions();
+	glState().invalidate(); // nothing is known about a fresh context
+
+	if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+		ext.GetProgramBinary = (GLEXTGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+		ext.ProgramBinary = (GLEXTPROGRAMBINARYPROC)load("glProgramBinary");
+		ext.ProgramParameteri = (GLEXTPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+		int formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		// some drivers expose the entry points but no formats, the cache is useless then
+		ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+	}
+
+	if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+		ext.MaxShaderCompilerThreads = (GLEXTMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+	}
+	else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+		ext.MaxShaderCompilerThreads = (GLEXTMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+	}
+	ext.parallelShaderCompile = ext.MaxShaderCompilerThreads != nullptr;
+
+	if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+		ext.BufferStorage = (GLEXTBUFFERSTORAGEPROC)load("glBufferStorage");
+	}
+	ext.bufferStorage = ext.BufferStorage != nullptr;
+
+	if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_texture_storage")) {
+		ext.TexStorage2D = (GLEXTTEXSTORAGE2DPROC)load("glTexStorage2D");
+		ext.TexStorage3D = (GLEXTTEXSTORAGE3DPROC)load("glTexStorage3D");
+	}
+	ext.textureStorage = ext.TexStorage2D != nullptr && ext.TexStorage3D != nullptr;
+
+	if (hasGLVersion(4, 3) || hasGLExtension("GL_ARB_copy_image")) {
+		ext.CopyImageSubData = (GLEXTCOPYIMAGESUBDATAPROC)load("glCopyImageSubData");
+	}
+	ext.copyImage = ext.CopyImageSubData != nullptr;
+
+	if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance")) {
+		ext.DrawElementsInstancedBaseVertexBaseInstance =
+			(GLEXTDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)load("glDrawElementsInstancedBaseVertexBaseInstance");
+	}
+	ext.baseInstance = ext.DrawElementsInstancedBaseVertexBaseInstance != nullptr;
+
+	// before base instance the indirect commands' baseInstance had to be 0, we rely on it
+	if (hasGLVersion(4, 3) || (ext.baseInstance && hasGLExtension("GL_ARB_multi_draw_indirect") && (hasGLVersion(4, 0) || hasGLExtension("GL_ARB_draw_indirect")))) {
+		ext.MultiDrawElementsIndirect = (GLEXTMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+	}
+	ext.multiDrawIndirect = ext.MultiDrawElementsIndirect != nullptr;
+
+	ext.textureCompressionS3TC = hasGLExtension("GL_EXT_texture_compression_s3tc");
+	ext.textureCompressionS3TCsRGB = ext.textureCompressionS3TC && hasGLExtension("GL_EXT_texture_sRGB");
+
+	ext.loaded = true;
+}
+
+#endif
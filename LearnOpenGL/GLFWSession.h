@@ -0,0 +1,23 @@
+#pragma once
+#ifndef GLFW_SESSION_H
+#define GLFW_SESSION_H
+
+#include <GLFW/glfw3.h>
+
+// glfwInit() on construction, glfwTerminate() on destruction
+// declare it before any Shader/GLObject in a function so those are destroyed first,
+// while their context still exists
+class GLFWSession {
+public:
+	GLFWSession() {
+		glfwInit();
+	}
+	~GLFWSession() {
+		glfwTerminate();
+	}
+
+	GLFWSession(const GLFWSession&) = delete;
+	GLFWSession& operator=(const GLFWSession&) = delete;
+};
+
+#endif
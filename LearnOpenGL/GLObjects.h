@@ -0,0 +1,131 @@
+#pragma once
+#ifndef GL_OBJECTS_H
+#define GL_OBJECTS_H
+
+#include <glad/glad.h>
+#include "./GLStateCache.h"
+
+#include <vector>
+#include <utility>
+
+// move-only owners for GL object names
+// moving only copies the name and zeroes the source, so these can sit in std::vectors
+// and be relocated freely without creating or deleting anything on the GL side
+// deleting name 0 is a no-op for every object type, which makes moved-from objects safe
+template <typename Traits>
+class GLObject {
+public:
+	GLObject() : name(0) {}
+	explicit GLObject(GLuint name) : name(name) {}
+
+	~GLObject() {
+		reset();
+	}
+
+	GLObject(const GLObject&) = delete;
+	GLObject& operator=(const GLObject&) = delete;
+
+	GLObject(GLObject&& other) noexcept : name(other.name) {
+		other.name = 0;
+	}
+	GLObject& operator=(GLObject&& other) noexcept {
+		if (this != &other) {
+			reset(other.name);
+			other.name = 0;
+		}
+		return *this;
+	}
+
+	// e.g. GLBuffer::create(), GLShaderObject::create(GL_VERTEX_SHADER)
+	template <typename... Args>
+	static GLObject create(Args... args) {
+		return GLObject(Traits::create(args...));
+	}
+
+	// one glGen* call for the whole batch
+	static std::vector<GLObject> createMany(GLsizei count) {
+		std::vector<GLuint> names(count);
+		Traits::generate(count, names.data());
+		std::vector<GLObject> objects;
+		objects.reserve(count);
+		for (GLuint generated : names) {
+			objects.push_back(GLObject(generated));
+		}
+		return objects;
+	}
+
+	GLuint id() const {
+		return name;
+	}
+	explicit operator bool() const {
+		return name != 0;
+	}
+
+	// give up ownership without deleting
+	GLuint release() {
+		GLuint released = name;
+		name = 0;
+		return released;
+	}
+
+	// delete what we own (if anything) and take over `replacement`
+	void reset(GLuint replacement = 0) {
+		if (name != 0) {
+			Traits::destroy(name);
+		}
+		name = replacement;
+	}
+
+private:
+	GLuint name;
+};
+
+struct GLBufferTraits {
+	static GLuint create() { GLuint name; glGenBuffers(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenBuffers(count, names); }
+	static void destroy(GLuint name) { glState().forgetBuffer(name); glDeleteBuffers(1, &name); }
+};
+struct GLVertexArrayTraits {
+	static GLuint create() { GLuint name; glGenVertexArrays(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenVertexArrays(count, names); }
+	static void destroy(GLuint name) { glState().forgetVertexArray(name); glDeleteVertexArrays(1, &name); }
+};
+struct GLTextureTraits {
+	static GLuint create() { GLuint name; glGenTextures(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenTextures(count, names); }
+	static void destroy(GLuint name) { glState().forgetTexture(name); glDeleteTextures(1, &name); }
+};
+struct GLFramebufferTraits {
+	static GLuint create() { GLuint name; glGenFramebuffers(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenFramebuffers(count, names); }
+	static void destroy(GLuint name) { glDeleteFramebuffers(1, &name); }
+};
+struct GLRenderbufferTraits {
+	static GLuint create() { GLuint name; glGenRenderbuffers(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenRenderbuffers(count, names); }
+	static void destroy(GLuint name) { glDeleteRenderbuffers(1, &name); }
+};
+struct GLSamplerTraits {
+	static GLuint create() { GLuint name; glGenSamplers(1, &name); return name; }
+	static void generate(GLsizei count, GLuint* names) { glGenSamplers(count, names); }
+	static void destroy(GLuint name) { glState().forgetSampler(name); glDeleteSamplers(1, &name); }
+};
+struct GLProgramTraits {
+	static GLuint create() { return glCreateProgram(); }
+	static void destroy(GLuint name) { glState().forgetProgram(name); glDeleteProgram(name); }
+};
+struct GLShaderObjectTraits {
+	static GLuint create(GLenum type) { return glCreateShader(type); }
+	static void destroy(GLuint name) { glDeleteShader(name); }
+};
+
+typedef GLObject<GLBufferTraits> GLBuffer;
+typedef GLObject<GLVertexArrayTraits> GLVertexArray;
+typedef GLObject<GLTextureTraits> GLTexture;
+typedef GLObject<GLFramebufferTraits> GLFramebuffer;
+typedef GLObject<GLRenderbufferTraits> GLRenderbuffer;
+typedef GLObject<GLSamplerTraits> GLSampler;
+typedef GLObject<GLProgramTraits> GLProgram;
+typedef GLObject<GLShaderObjectTraits> GLShaderObject;
+
+#endif
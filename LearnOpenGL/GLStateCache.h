@@ -0,0 +1,321 @@
+#pragma once
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// ARB_draw_indirect (core in 4.0), our glad stops at 3.3
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// shadows the GL state we change every frame (program, vertex array, buffers, texture units,
+// samplers, a few capabilities, blend/depth state, viewport) and drops calls that wouldn't
+// change anything, which the driver would otherwise still have to validate
+// counts issued and elided calls per frame, call endFrame() once a frame to roll them over
+// state starts out unknown (every first call goes through), and code that changes tracked
+// state behind the cache's back has to put it back the way it found it or call invalidate()
+// GLObject deleters tell the cache about deleted names, so a recycled name is never mistaken
+// for one that's still bound
+class GLStateCache {
+public:
+	struct Stats {
+		unsigned int issued = 0;
+		unsigned int elided = 0;
+	};
+
+	static const int MAX_UNITS = 32; // units past this aren't tracked, their binds always go through
+
+	GLStateCache() {
+		invalidate();
+	}
+
+	// forget everything, e.g. for a new context or after code that doesn't use the cache
+	void invalidate() {
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (GLuint& buffer : buffers) {
+			buffer = UNKNOWN;
+		}
+		for (int unit = 0; unit < MAX_UNITS; ++unit) {
+			for (GLuint& texture : textures[unit]) {
+				texture = UNKNOWN;
+			}
+			samplers[unit] = UNKNOWN;
+		}
+		for (int& capability : capabilities) {
+			capability = -1;
+		}
+		blendSource = blendDestination = UNKNOWN;
+		depthFunction = UNKNOWN;
+		depthWrites = -1;
+		viewportKnown = false;
+	}
+
+	void useProgram(GLuint name) {
+		if (track(program, name)) {
+			glUseProgram(name);
+		}
+	}
+
+	void bindVertexArray(GLuint name) {
+		if (track(vertexArray, name)) {
+			glBindVertexArray(name);
+		}
+	}
+
+	// GL_ELEMENT_ARRAY_BUFFER belongs to the vertex array and the pixel buffers are bound
+	// and unbound around uploads elsewhere, those (and anything else untracked) always go through
+	void bindBuffer(GLenum target, GLuint name) {
+		int slot = bufferSlot(target);
+		if (slot < 0 || track(buffers[slot], name)) {
+			glBindBuffer(target, name);
+		}
+	}
+
+	// also binds the buffer to the generic target, like the GL does
+	void bindBufferBase(GLenum target, GLuint index, GLuint name) {
+		glBindBufferBase(target, index, name);
+		frame.issued++;
+		int slot = bufferSlot(target);
+		if (slot >= 0) {
+			buffers[slot] = name;
+		}
+	}
+
+	// same for a range of the buffer
+	void bindBufferRange(GLenum target, GLuint index, GLuint name, GLintptr offset, GLsizeiptr size) {
+		glBindBufferRange(target, index, name, offset, size);
+		frame.issued++;
+		int slot = bufferSlot(target);
+		if (slot >= 0) {
+			buffers[slot] = name;
+		}
+	}
+
+	void activeTexture(GLuint unit) {
+		if (track(activeUnit, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+	}
+
+	// switches the active unit only when the bind actually has to happen
+	void bindTexture(GLuint unit, GLenum target, GLuint name) {
+		int slot = textureSlot(target);
+		if (unit >= (GLuint)MAX_UNITS || slot < 0) {
+			activeTexture(unit);
+			glBindTexture(target, name);
+			frame.issued++;
+			return;
+		}
+		if (track(textures[unit][slot], name)) {
+			activeTexture(unit);
+			glBindTexture(target, name);
+		}
+	}
+
+	void bindSampler(GLuint unit, GLuint name) {
+		if (unit >= (GLuint)MAX_UNITS || track(samplers[unit], name)) {
+			glBindSampler(unit, name);
+		}
+	}
+
+	void setEnabled(GLenum capability, bool enabled) {
+		int slot = capabilitySlot(capability);
+		if (slot >= 0 && capabilities[slot] == (enabled ? 1 : 0)) {
+			frame.elided++;
+			return;
+		}
+		if (slot >= 0) {
+			capabilities[slot] = enabled ? 1 : 0;
+		}
+		if (enabled) {
+			glEnable(capability);
+		}
+		else {
+			glDisable(capability);
+		}
+		frame.issued++;
+	}
+	void enable(GLenum capability) {
+		setEnabled(capability, true);
+	}
+	void disable(GLenum capability) {
+		setEnabled(capability, false);
+	}
+
+	void blendFunc(GLenum source, GLenum destination) {
+		if (blendSource == source && blendDestination == destination) {
+			frame.elided++;
+			return;
+		}
+		blendSource = source;
+		blendDestination = destination;
+		glBlendFunc(source, destination);
+		frame.issued++;
+	}
+
+	void depthFunc(GLenum function) {
+		if (track(depthFunction, function)) {
+			glDepthFunc(function);
+		}
+	}
+
+	void depthMask(GLboolean writes) {
+		if (depthWrites == (writes ? 1 : 0)) {
+			frame.elided++;
+			return;
+		}
+		depthWrites = writes ? 1 : 0;
+		glDepthMask(writes);
+		frame.issued++;
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		if (viewportKnown && viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height) {
+			frame.elided++;
+			return;
+		}
+		viewportKnown = true;
+		viewportRect[0] = x;
+		viewportRect[1] = y;
+		viewportRect[2] = width;
+		viewportRect[3] = height;
+		glViewport(x, y, width, height);
+		frame.issued++;
+	}
+
+	// deleting a bound texture, buffer or vertex array unbinds it, a deleted program stays
+	// in use until the next glUseProgram, so that one becomes unknown instead
+	void forgetProgram(GLuint name) {
+		if (program == name) {
+			program = UNKNOWN;
+		}
+	}
+	void forgetVertexArray(GLuint name) {
+		if (vertexArray == name) {
+			vertexArray = 0;
+		}
+	}
+	void forgetBuffer(GLuint name) {
+		for (GLuint& buffer : buffers) {
+			if (buffer == name) {
+				buffer = 0;
+			}
+		}
+	}
+	void forgetTexture(GLuint name) {
+		for (int unit = 0; unit < MAX_UNITS; ++unit) {
+			for (GLuint& texture : textures[unit]) {
+				if (texture == name) {
+					texture = 0;
+				}
+			}
+		}
+	}
+	void forgetSampler(GLuint name) {
+		for (GLuint& sampler : samplers) {
+			if (sampler == name) {
+				sampler = 0;
+			}
+		}
+	}
+
+	// once per frame, after the last call of the frame
+	void endFrame() {
+		lastFrame = frame;
+		total.issued += frame.issued;
+		total.elided += frame.elided;
+		frame = Stats();
+	}
+
+	// the frame endFrame() last closed
+	const Stats& frameStats() const {
+		return lastFrame;
+	}
+	const Stats& totalStats() const {
+		return total;
+	}
+
+	void printStats() const {
+		unsigned int calls = total.issued + total.elided;
+		std::cout << "GL state cache: " << lastFrame.issued << " calls issued, " << lastFrame.elided << " elided last frame, "
+			<< (calls ? 100.0 * total.elided / calls : 0.0) << "% elided overall" << std::endl;
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint activeUnit;
+	GLuint buffers[6];     // see bufferSlot()
+	GLuint textures[MAX_UNITS][4]; // see textureSlot()
+	GLuint samplers[MAX_UNITS];
+	int capabilities[6];   // see capabilitySlot(), -1 unknown
+	GLenum blendSource;
+	GLenum blendDestination;
+	GLenum depthFunction;
+	int depthWrites;
+	bool viewportKnown;
+	GLint viewportRect[4];
+	Stats frame;
+	Stats lastFrame;
+	Stats total;
+
+	// true (and the new value recorded) if the call has to be made
+	bool track(GLuint& current, GLuint value) {
+		if (current == value) {
+			frame.elided++;
+			return false;
+		}
+		current = value;
+		frame.issued++;
+		return true;
+	}
+
+	static int bufferSlot(GLenum target) {
+		switch (target) {
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_UNIFORM_BUFFER: return 1;
+		case GL_COPY_READ_BUFFER: return 2;
+		case GL_COPY_WRITE_BUFFER: return 3;
+		case GL_TEXTURE_BUFFER: return 4;
+		case GL_DRAW_INDIRECT_BUFFER: return 5;
+		default: return -1;
+		}
+	}
+
+	static int textureSlot(GLenum target) {
+		switch (target) {
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_2D_ARRAY: return 1;
+		case GL_TEXTURE_CUBE_MAP: return 2;
+		case GL_TEXTURE_3D: return 3;
+		default: return -1;
+		}
+	}
+
+	static int capabilitySlot(GLenum capability) {
+		switch (capability) {
+		case GL_BLEND: return 0;
+		case GL_DEPTH_TEST: return 1;
+		case GL_CULL_FACE: return 2;
+		case GL_SCISSOR_TEST: return 3;
+		case GL_STENCIL_TEST: return 4;
+		case GL_FRAMEBUFFER_SRGB: return 5;
+		default: return -1;
+		}
+	}
+};
+
+// the cache for the current context
+inline GLStateCache& glState() {
+	static GLStateCache cache;
+	return cache;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#pragma once
+#ifndef INSTANCED_MESH_H
+#define INSTANCED_MESH_H
+
+#include <glad/glad.h>
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./DrawQueue.h"
+#include "./StreamRing.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+// per instance attributes, one of these per copy of the mesh, read in the vertex shader as
+//   layout (location = 3) in mat4 aInstanceTransform; // locations 3-6, one per column
+//   layout (location = 7) in vec4 aInstanceTint;
+//   layout (location = 8) in vec2 aInstanceParams;    // x texture array layer, y mix amount
+// (the first location moves with InstancedMesh's firstLocation, the mesh's own attributes stay below it)
+struct InstanceData {
+	float transform[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f }; // column major
+	float tint[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float layer = 0.0f;
+	float mixAmt = 0.0f;
+	float padding[2] = {}; // 96 bytes, instances stay 16 byte aligned
+};
+static_assert(offsetof(InstanceData, tint) == 64, "InstanceData::tint has to follow the mat4");
+static_assert(offsetof(InstanceData, layer) == 80, "InstanceData::layer has to follow the tint");
+static_assert(sizeof(InstanceData) == 96, "InstanceData is uploaded as is");
+
+// points the instance attributes at InstanceData in the bound GL_ARRAY_BUFFER, starting at
+// `firstInstance`, advancing once per instance
+// the bound vertex array keeps the pointers, like glVertexAttribPointer always does
+inline void setInstanceAttributes(GLuint firstLocation, size_t firstInstance = 0) {
+	const size_t base = firstInstance * sizeof(InstanceData);
+	const struct {
+		GLint components;
+		size_t offset;
+	} attributes[6] = {
+		// a mat4 attribute takes four locations, one vec4 column each
+		{ 4, offsetof(InstanceData, transform) }, { 4, offsetof(InstanceData, transform) + 4 * sizeof(float) },
+		{ 4, offsetof(InstanceData, transform) + 8 * sizeof(float) }, { 4, offsetof(InstanceData, transform) + 12 * sizeof(float) },
+		{ 4, offsetof(InstanceData, tint) }, { 2, offsetof(InstanceData, layer) },
+	};
+	for (GLuint i = 0; i < 6; ++i) {
+		glVertexAttribPointer(firstLocation + i, attributes[i].components, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + attributes[i].offset));
+		glEnableVertexAttribArray(firstLocation + i);
+		glVertexAttribDivisor(firstLocation + i, 1);
+	}
+}
+
+// a mesh (vertex array with an index buffer) drawn many times in one glDrawElementsInstanced,
+// everything that differs between the copies comes from an instance buffer whose attributes
+// advance once per instance (glVertexAttribDivisor) instead of once per vertex
+// the instance attributes are added to the mesh's own vertex array, a plain glDrawElements
+// with it afterwards draws just the first instance
+class InstancedMesh {
+public:
+	static const GLuint DEFAULT_FIRST_LOCATION = 3; // after position, color and texture coordinates
+
+	InstancedMesh() {}
+
+	// vertexArray has its vertex attributes and index buffer set up already and has to outlive this
+	InstancedMesh(GLuint vertexArray, GLsizei indexCount, GLenum indexType = GL_UNSIGNED_INT, GLuint firstLocation = DEFAULT_FIRST_LOCATION)
+		: vertexArray(vertexArray), indexCount(indexCount), indexType(indexType), firstLocation(firstLocation), instanceBuffer(GLBuffer::create()) {
+		glState().bindVertexArray(vertexArray);
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+		setInstanceAttributes(firstLocation);
+	}
+
+	// replaces the instances, the storage is reallocated (orphaned) every time so a frame still
+	// drawing the previous instances never stalls this upload, and grows with some headroom
+	void setInstances(const InstanceData* instances, size_t count) {
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+		if (streamed) {
+			glState().bindVertexArray(vertexArray);
+			setInstanceAttributes(firstLocation);
+			streamed = false;
+		}
+		if (count > capacity) {
+			capacity = count + count / 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		if (count > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+		}
+		storedInstances = count;
+	}
+	void setInstances(const std::vector<InstanceData>& instances) {
+		setInstances(instances.data(), instances.size());
+	}
+
+	// writes the instances into this frame's part of `ring` instead and points the attributes
+	// there, no glBufferSubData copy and no orphaning
+	void setInstances(const InstanceData* instances, size_t count, StreamRing& ring) {
+		// aligned to whole instances, so the attributes can start at an instance index
+		StreamRing::Allocation allocation = ring.allocate(count * sizeof(InstanceData), sizeof(InstanceData));
+		if (!allocation) {
+			storedInstances = 0;
+			return;
+		}
+		std::memcpy(allocation.memory, instances, allocation.size);
+		ring.commit(allocation);
+		glState().bindVertexArray(vertexArray);
+		glState().bindBuffer(GL_ARRAY_BUFFER, ring.id());
+		setInstanceAttributes(firstLocation, (size_t)allocation.offset / sizeof(InstanceData));
+		storedInstances = count;
+		streamed = true;
+	}
+	void setInstances(const std::vector<InstanceData>& instances, StreamRing& ring) {
+		setInstances(instances.data(), instances.size(), ring);
+	}
+
+	size_t instanceCount() const {
+		return storedInstances;
+	}
+
+	// every instance in one call, the program and textures have to be bound already
+	void draw() const {
+		if (storedInstances == 0) {
+			return;
+		}
+		glState().bindVertexArray(vertexArray);
+		glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (const void*)0, (GLsizei)storedInstances);
+	}
+
+	// the same draw for a DrawQueue, textures still to be filled in
+	DrawCommand command(GLuint program) const {
+		DrawCommand command;
+		command.program = program;
+		command.vertexArray = vertexArray;
+		command.indexType = indexType;
+		command.count = indexCount;
+		command.instanceCount = (GLsizei)storedInstances;
+		return command;
+	}
+
+private:
+	GLuint vertexArray = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLuint firstLocation = DEFAULT_FIRST_LOCATION;
+	GLBuffer instanceBuffer;
+	size_t capacity = 0;  // in instances
+	size_t storedInstances = 0;
+	bool streamed = false; // the attributes point into a StreamRing
+};
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <iostream>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// a whole file mapped read-only into memory (mmap / CreateFileMapping)
+// the OS pages it in on first touch and keeps it in the page cache between runs,
+// so nothing is read into a buffer of ours
+// the file and mapping handles are closed right away, the view keeps the mapping alive
+class MappedFile {
+public:
+	MappedFile() {}
+
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false if the file doesn't exist, is empty or can't be mapped
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (!mapping) {
+			return false;
+		}
+		bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!bytes) {
+			return false;
+		}
+		length = (size_t)fileSize.QuadPart;
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0) {
+			::close(file);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		bytes = (const unsigned char*)view;
+		length = (size_t)info.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+		if (!bytes) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(bytes);
+#else
+		munmap((void*)bytes, length);
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+	// reads one byte per page so the page faults happen on the calling thread
+	// (a loader worker) rather than inside the GL call that reads the data
+	void prefault() const {
+		volatile unsigned char sink = 0;
+		for (size_t offset = 0; offset < length; offset += 4096) {
+			sink = sink + bytes[offset];
+		}
+	}
+
+	const unsigned char* data() const {
+		return bytes;
+	}
+	size_t size() const {
+		return length;
+	}
+
+private:
+	const unsigned char* bytes = nullptr;
+	size_t length = 0;
+};
+
+#endif
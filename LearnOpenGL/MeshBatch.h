@@ -0,0 +1,251 @@
+#pragma once
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./InstancedMesh.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// one draw as the GL reads it from GL_DRAW_INDIRECT_BUFFER, don't reorder
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand is read by the GL as is");
+
+// a vertex attribute of the meshes in a batch, offset in bytes into a vertex
+struct MeshAttribute {
+	GLuint location;
+	GLint components; // floats
+	size_t offset;
+};
+
+// where a mesh ended up in its batch's shared buffers
+struct BatchedMesh {
+	GLuint firstIndex = 0;
+	GLuint indexCount = 0;
+	GLint baseVertex = 0;
+};
+
+// many meshes of the same vertex layout in one vertex and one index buffer, so drawing any mix
+// of them needs no vertex array switch, and a frame's draws become DrawElementsIndirectCommands:
+// with multi draw indirect (4.3) that's one glMultiDrawElementsIndirect for all of them
+// per draw values (transform, tint, ...) are InstanceData read through baseInstance, see InstancedMesh.h
+// older contexts fall back to one call per draw with base instance (4.2), and on plain 3.3 to
+// glMultiDrawElementsBaseVertex over every run of draws sharing their InstanceData (consecutive
+// draws with identical InstanceData share one copy of it), re-pointing the instance attributes
+// between runs
+// one flush() per program/texture set (material), what's bound when it's called is what's used
+class MeshBatch {
+public:
+	enum class Path {
+		MultiDrawIndirect, // one call per flush
+		BaseInstanceLoop,  // one call per draw
+		MultiDrawRuns      // one call per run of draws sharing InstanceData
+	};
+
+	struct Stats {
+		unsigned int draws = 0; // per flush
+		unsigned int calls = 0; // draw calls it took
+	};
+
+	// vertexStride in bytes, the instance attributes go from instanceLocation up
+	MeshBatch(GLsizei vertexStride, const std::vector<MeshAttribute>& attributes, GLuint instanceLocation = InstancedMesh::DEFAULT_FIRST_LOCATION)
+		: vertexStride(vertexStride), attributes(attributes), instanceLocation(instanceLocation) {
+		if (glExt().multiDrawIndirect) {
+			activePath = Path::MultiDrawIndirect;
+		}
+		else if (glExt().baseInstance) {
+			activePath = Path::BaseInstanceLoop;
+		}
+		else {
+			activePath = Path::MultiDrawRuns;
+		}
+	}
+
+	// copies the mesh in, nothing reaches the GL until build()
+	BatchedMesh addMesh(const void* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount) {
+		BatchedMesh mesh;
+		mesh.firstIndex = (GLuint)meshIndices.size();
+		mesh.indexCount = (GLuint)indexCount;
+		mesh.baseVertex = (GLint)(meshVertices.size() / vertexStride);
+		const unsigned char* bytes = (const unsigned char*)vertices;
+		meshVertices.insert(meshVertices.end(), bytes, bytes + vertexCount * vertexStride);
+		meshIndices.insert(meshIndices.end(), indices, indices + indexCount);
+		return mesh;
+	}
+
+	// GL thread, uploads every mesh added so far and sets up the vertex array
+	void build() {
+		vertexArray = GLVertexArray::create();
+		vertexBuffer = GLBuffer::create();
+		indexBuffer = GLBuffer::create();
+		instanceBuffer = GLBuffer::create();
+		glState().bindVertexArray(vertexArray.id());
+		glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer.id());
+		glBufferData(GL_ARRAY_BUFFER, meshVertices.size(), meshVertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.id());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshIndices.size() * sizeof(GLuint), meshIndices.data(), GL_STATIC_DRAW);
+		for (const MeshAttribute& attribute : attributes) {
+			glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, vertexStride, (void*)attribute.offset);
+			glEnableVertexAttribArray(attribute.location);
+		}
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+		setInstanceAttributes(instanceLocation);
+		instanceBase = 0;
+		if (activePath == Path::MultiDrawIndirect) {
+			commandBuffer = GLBuffer::create();
+		}
+		// the GL has its copy
+		meshVertices = std::vector<unsigned char>();
+		meshIndices = std::vector<GLuint>();
+	}
+
+	// another path for the draws (to compare them), false if the context can't do it
+	bool setPath(Path path) {
+		if ((path == Path::MultiDrawIndirect && !glExt().multiDrawIndirect) || (path == Path::BaseInstanceLoop && !glExt().baseInstance)) {
+			return false;
+		}
+		if (path == Path::MultiDrawIndirect && !commandBuffer) {
+			commandBuffer = GLBuffer::create();
+		}
+		activePath = path;
+		return true;
+	}
+	Path path() const {
+		return activePath;
+	}
+
+	// queues `count` instances of `mesh`, reading instances[0..count)
+	void draw(const BatchedMesh& mesh, const InstanceData* instances, GLuint count) {
+		DrawElementsIndirectCommand command;
+		command.count = mesh.indexCount;
+		command.instanceCount = count;
+		command.firstIndex = mesh.firstIndex;
+		command.baseVertex = mesh.baseVertex;
+		if (count == 1 && !instanceData.empty() && std::memcmp(&instanceData.back(), instances, sizeof(InstanceData)) == 0) {
+			command.baseInstance = (GLuint)instanceData.size() - 1;
+		}
+		else {
+			command.baseInstance = (GLuint)instanceData.size();
+			instanceData.insert(instanceData.end(), instances, instances + count);
+		}
+		commands.push_back(command);
+	}
+	void draw(const BatchedMesh& mesh, const InstanceData& instance) {
+		draw(mesh, &instance, 1);
+	}
+
+	size_t queuedDraws() const {
+		return commands.size();
+	}
+
+	// issues every queued draw with whatever program and textures are bound, then empties the queue
+	void flush() {
+		stats = Stats();
+		if (commands.empty()) {
+			return;
+		}
+		glState().bindVertexArray(vertexArray.id());
+		// orphaned every flush, a frame still reading the previous contents never stalls the upload
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+		glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+
+		if (activePath == Path::MultiDrawIndirect) {
+			pointInstanceAttributes(0);
+			glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+			glExt().MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)0, (GLsizei)commands.size(), 0);
+			stats.calls = 1;
+		}
+		else if (activePath == Path::BaseInstanceLoop) {
+			pointInstanceAttributes(0);
+			for (const DrawElementsIndirectCommand& command : commands) {
+				glExt().DrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+					(const void*)(command.firstIndex * sizeof(GLuint)), (GLsizei)command.instanceCount, command.baseVertex, command.baseInstance);
+			}
+			stats.calls = (unsigned int)commands.size();
+		}
+		else {
+			flushRuns();
+		}
+		stats.draws = (unsigned int)commands.size();
+		commands.clear();
+		instanceData.clear();
+	}
+
+	const Stats& getStats() const {
+		return stats;
+	}
+
+private:
+	GLsizei vertexStride;
+	std::vector<MeshAttribute> attributes;
+	GLuint instanceLocation;
+	Path activePath;
+
+	std::vector<unsigned char> meshVertices; // until build()
+	std::vector<GLuint> meshIndices;
+	GLVertexArray vertexArray;
+	GLBuffer vertexBuffer;
+	GLBuffer indexBuffer;
+	GLBuffer instanceBuffer;
+	GLBuffer commandBuffer;
+	size_t instanceBase = 0; // instance the attributes point at right now
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<InstanceData> instanceData;
+	// scratch for flushRuns(), kept to not allocate every frame
+	std::vector<GLsizei> runCounts;
+	std::vector<const void*> runOffsets;
+	std::vector<GLint> runBaseVertices;
+	Stats stats;
+
+	// expects the vertex array and the instance buffer bound
+	void pointInstanceAttributes(size_t firstInstance) {
+		if (instanceBase != firstInstance) {
+			setInstanceAttributes(instanceLocation, firstInstance);
+			instanceBase = firstInstance;
+		}
+	}
+
+	// 3.3: no way to tell the GL a per draw base instance, so draws sharing an InstanceData
+	// go out together and the attributes move between them
+	void flushRuns() {
+		for (size_t begin = 0; begin < commands.size();) {
+			const DrawElementsIndirectCommand& first = commands[begin];
+			pointInstanceAttributes(first.baseInstance);
+			if (first.instanceCount != 1) {
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)first.count, GL_UNSIGNED_INT,
+					(const void*)(first.firstIndex * sizeof(GLuint)), (GLsizei)first.instanceCount, first.baseVertex);
+				stats.calls++;
+				begin++;
+				continue;
+			}
+			runCounts.clear();
+			runOffsets.clear();
+			runBaseVertices.clear();
+			size_t end = begin;
+			for (; end < commands.size() && commands[end].instanceCount == 1 && commands[end].baseInstance == first.baseInstance; ++end) {
+				runCounts.push_back((GLsizei)commands[end].count);
+				runOffsets.push_back((const void*)(commands[end].firstIndex * sizeof(GLuint)));
+				runBaseVertices.push_back(commands[end].baseVertex);
+			}
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, runCounts.data(), GL_UNSIGNED_INT, runOffsets.data(), (GLsizei)runCounts.size(), runBaseVertices.data());
+			stats.calls++;
+			begin = end;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,254 @@
+#pragma once
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define MIP_GENERATOR_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC compiles AVX2 intrinsics without /arch:AVX2, they only run after the cpuid check
+#define MIP_TARGET_AVX2
+#else
+#define MIP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// one level of a mip chain, tightly packed rows
+struct MipLevel {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+enum class MipPath {
+	Auto,   // the fastest one this CPU supports
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+// builds mip chains of 8 bit images on the CPU (2x2 box filter, like glGenerateMipmap)
+// so worker threads can hand over every level together with the base image
+// linear data is averaged in SSE2/AVX2, sRGB color is averaged in linear space through
+// lookup tables (alpha stays linear) so the smaller levels don't darken
+// all paths round the same way and give identical results
+class MipGenerator {
+public:
+	// levels 1 and down to 1x1, level 0 is `pixels` itself
+	static std::vector<MipLevel> generate(const unsigned char* pixels, int width, int height, int channels, bool srgb, MipPath path = MipPath::Auto) {
+		std::vector<MipLevel> levels;
+		const unsigned char* source = pixels;
+		while (width > 1 || height > 1) {
+			MipLevel level;
+			level.width = width > 1 ? width / 2 : 1;
+			level.height = height > 1 ? height / 2 : 1;
+			level.pixels.resize((size_t)level.width * level.height * channels);
+			downsample(source, width, height, level.pixels.data(), channels, srgb, path);
+			levels.push_back(std::move(level));
+			source = levels.back().pixels.data();
+			width = levels.back().width;
+			height = levels.back().height;
+		}
+		return levels;
+	}
+
+	// one level: `dst` is max(1, width / 2) x max(1, height / 2)
+	static void downsample(const unsigned char* src, int width, int height, unsigned char* dst, int channels, bool srgb, MipPath path = MipPath::Auto) {
+		if (path == MipPath::Auto) {
+			path = bestPath();
+		}
+		int dstWidth = width > 1 ? width / 2 : 1;
+		int dstHeight = height > 1 ? height / 2 : 1;
+		size_t srcStride = (size_t)width * channels;
+		size_t dstStride = (size_t)dstWidth * channels;
+		std::vector<uint16_t> columnSums; // vertical pair sums of one row, the generic SIMD paths use it
+
+		for (int y = 0; y < dstHeight; ++y) {
+			const unsigned char* row0 = src + (size_t)(2 * y) * srcStride;
+			const unsigned char* row1 = height > 1 ? row0 + srcStride : row0;
+			unsigned char* out = dst + (size_t)y * dstStride;
+			// sRGB and 1 pixel wide images never take the vector paths
+			if (srgb || width == 1 || path == MipPath::Scalar) {
+				downsampleRowScalar(row0, row1, width, out, dstWidth, channels, srgb);
+			}
+#ifdef MIP_GENERATOR_X86
+			else if (channels == 4) {
+				int done = path == MipPath::AVX2 ? downsampleRowRGBA_AVX2(row0, row1, out, dstWidth) : downsampleRowRGBA_SSE2(row0, row1, out, dstWidth);
+				downsampleRowScalar(row0 + (size_t)done * 8, row1 + (size_t)done * 8, width - done * 2, out + (size_t)done * 4, dstWidth - done, 4, false);
+			}
+			else {
+				// RGB pixels don't line up with vector lanes, sum the rows in SIMD and pair columns after
+				columnSums.resize((size_t)dstWidth * 2 * channels);
+				if (path == MipPath::AVX2) {
+					sumRows_AVX2(row0, row1, columnSums.data(), columnSums.size());
+				}
+				else {
+					sumRows_SSE2(row0, row1, columnSums.data(), columnSums.size());
+				}
+				for (int x = 0; x < dstWidth; ++x) {
+					const uint16_t* pair = columnSums.data() + (size_t)x * 2 * channels;
+					for (int c = 0; c < channels; ++c) {
+						out[x * channels + c] = (unsigned char)((pair[c] + pair[c + channels] + 2) >> 2);
+					}
+				}
+			}
+#else
+			else {
+				downsampleRowScalar(row0, row1, width, out, dstWidth, channels, false);
+			}
+#endif
+		}
+	}
+
+	static bool hasAVX2() {
+#ifdef MIP_GENERATOR_X86
+		static const bool supported = detectAVX2();
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	static MipPath bestPath() {
+#ifdef MIP_GENERATOR_X86
+		return hasAVX2() ? MipPath::AVX2 : MipPath::SSE2;
+#else
+		return MipPath::Scalar;
+#endif
+	}
+
+private:
+	// sRGB byte -> 16 bit linear and back, built once
+	struct SrgbTables {
+		uint16_t toLinear[256];
+		unsigned char fromLinear[65536];
+
+		SrgbTables() {
+			for (int i = 0; i < 256; ++i) {
+				double c = i / 255.0;
+				double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+				toLinear[i] = (uint16_t)(linear * 65535.0 + 0.5);
+			}
+			for (int i = 0; i < 65536; ++i) {
+				double linear = i / 65535.0;
+				double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+				fromLinear[i] = (unsigned char)(c * 255.0 + 0.5);
+			}
+		}
+	};
+	static const SrgbTables& srgbTables() {
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// the reference every other path has to match
+	static void downsampleRowScalar(const unsigned char* row0, const unsigned char* row1, int width, unsigned char* out, int dstWidth, int channels, bool srgb) {
+		const SrgbTables* tables = srgb ? &srgbTables() : nullptr;
+		// only RGB(A) has sRGB formats, alpha and one or two channel images stay linear
+		int colorChannels = channels >= 3 ? 3 : 0;
+		for (int x = 0; x < dstWidth; ++x) {
+			int x0 = 2 * x;
+			int x1 = x0 + 1 < width ? x0 + 1 : x0;
+			for (int c = 0; c < channels; ++c) {
+				unsigned int a = row0[x0 * channels + c], b = row0[x1 * channels + c];
+				unsigned int d = row1[x0 * channels + c], e = row1[x1 * channels + c];
+				if (tables && c < colorChannels) {
+					unsigned int sum = tables->toLinear[a] + tables->toLinear[b] + tables->toLinear[d] + tables->toLinear[e];
+					out[x * channels + c] = tables->fromLinear[(sum + 2) >> 2];
+				}
+				else {
+					out[x * channels + c] = (unsigned char)((a + b + d + e + 2) >> 2);
+				}
+			}
+		}
+	}
+
+#ifdef MIP_GENERATOR_X86
+	// 4 source pixels from each row -> 2 output pixels per step, returns how many outputs it wrote
+	static int downsampleRowRGBA_SSE2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int dstWidth) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		int x = 0;
+		for (; x + 2 <= dstWidth; x += 2) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)); // pixels 0, 1
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); // pixels 2, 3
+			__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi)); // 0+1, 2+3
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, sum));
+		}
+		return x;
+	}
+
+	// 8 source pixels from each row -> 4 output pixels per step
+	MIP_TARGET_AVX2 static int downsampleRowRGBA_AVX2(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int dstWidth) {
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i two = _mm256_set1_epi16(2);
+		int x = 0;
+		for (; x + 4 <= dstWidth; x += 4) {
+			__m256i a = _mm256_loadu_si256((const __m256i*)(row0 + x * 8));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(row1 + x * 8));
+			// unpacks work per 128 bit lane: lo holds pixels 0,1 | 4,5 and hi 2,3 | 6,7
+			__m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+			__m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+			__m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+			sum = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+			// outputs 0,1 sit in the low qword of lane 0 and 2,3 in the low qword of lane 1
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm256_castsi256_si128(packed));
+		}
+		return x + downsampleRowRGBA_SSE2(row0 + (size_t)x * 8, row1 + (size_t)x * 8, out + (size_t)x * 4, dstWidth - x);
+	}
+
+	// sums[i] = row0[i] + row1[i] for the first `count` bytes
+	static void sumRows_SSE2(const unsigned char* row0, const unsigned char* row1, uint16_t* sums, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + i));
+			_mm_storeu_si128((__m128i*)(sums + i), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+			_mm_storeu_si128((__m128i*)(sums + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+		}
+		for (; i < count; ++i) {
+			sums[i] = (uint16_t)(row0[i] + row1[i]);
+		}
+	}
+
+	MIP_TARGET_AVX2 static void sumRows_AVX2(const unsigned char* row0, const unsigned char* row1, uint16_t* sums, size_t count) {
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(row0 + i)));
+			__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(row1 + i)));
+			_mm256_storeu_si256((__m256i*)(sums + i), _mm256_add_epi16(a, b));
+		}
+		sumRows_SSE2(row0 + i, row1 + i, sums + i, count - i);
+	}
+
+	static bool detectAVX2() {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+};
+
+#endif
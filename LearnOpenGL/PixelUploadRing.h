@@ -0,0 +1,185 @@
+#pragma once
+#ifndef PIXEL_UPLOAD_RING_H
+#define PIXEL_UPLOAD_RING_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./Texture.h"
+#include "./LockFreeQueue.h"
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+
+// a ring of pixel unpack buffers to stage texture uploads in
+// any thread can acquire a free slot and write pixels into its mapped memory, the GL thread
+// then only issues the copy out of the buffer (glTexImage2D with an offset), which the
+// driver can do without first copying from client memory or stalling the frame
+// a fence after each copy tells recycle() when the slot may be written again
+// with ARB_buffer_storage the slots stay persistently mapped, otherwise they are
+// mapped on the GL thread whenever they go back on the free list
+class PixelUploadRing {
+public:
+	struct Stats {
+		unsigned int uploads = 0;
+		unsigned int waitsForSlot = 0; // tryAcquire() calls that found every slot busy
+		size_t bytes = 0;
+	};
+
+	// GL thread, slotBytes is the largest image the ring can stage
+	explicit PixelUploadRing(size_t slotBytes = 4 * 1024 * 1024, unsigned int slotCount = 8)
+		: slotSize(slotBytes), slots(slotCount), freeSlots(slotCount) {
+		persistentlyMapped = glExt().bufferStorage;
+		std::vector<GLBuffer> buffers = GLBuffer::createMany((GLsizei)slotCount);
+		for (unsigned int i = 0; i < slotCount; ++i) {
+			Slot& slot = slots[i];
+			slot.buffer = std::move(buffers[i]);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer.id());
+			if (persistentlyMapped) {
+				GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glExt().BufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)slotSize, NULL, flags);
+				slot.memory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)slotSize, flags);
+			}
+			else {
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)slotSize, NULL, GL_STREAM_DRAW);
+				slot.memory = map();
+			}
+			if (!slot.memory) {
+				std::cout << "ERROR::TEXTURE::STAGING::MAP_FAILED slot " << i << std::endl;
+				continue;
+			}
+			int index = (int)i;
+			freeSlots.tryPush(index);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// GL thread, everything acquired must have been uploaded or released by now
+	~PixelUploadRing() {
+		for (Slot& slot : slots) {
+			if (slot.fence) {
+				glDeleteSync(slot.fence);
+			}
+			if (slot.memory && slot.buffer) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer.id());
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	PixelUploadRing(const PixelUploadRing&) = delete;
+	PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+	size_t slotBytes() const {
+		return slotSize;
+	}
+	bool persistent() const {
+		return persistentlyMapped;
+	}
+
+	// any thread, a slot to write pixels into or -1 if they're all in use right now
+	int tryAcquire() {
+		int slot = -1;
+		if (!freeSlots.tryPop(slot)) {
+			slotWaits++;
+			return -1;
+		}
+		return slot;
+	}
+
+	// mapped memory of an acquired slot, slotBytes() long
+	unsigned char* memory(int slot) {
+		return slots[slot].memory;
+	}
+
+	// any thread, hand back a slot without uploading from it
+	void release(int slot) {
+		freeSlots.tryPush(slot);
+	}
+
+	// GL thread, creates the texture from the pixels written into `slot`
+	// `levelCount` mip levels are packed one after the other, base level first
+	GLTexture upload(int slot, int width, int height, int channels, int levelCount, const TextureParams& params) {
+		Slot& staging = slots[slot];
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer.id());
+		if (!persistentlyMapped) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			staging.memory = nullptr;
+		}
+		std::vector<const void*> offsets;
+		size_t offset = 0;
+		for (int level = 0, w = width, h = height; level < levelCount; ++level) {
+			offsets.push_back((const void*)offset);
+			offset += (size_t)w * h * channels;
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+		GLTexture texture = uploadTexture2D(width, height, channels, offsets.data(), levelCount, params);
+		// unbound again right away, client memory uploads would read from the buffer otherwise
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		inFlight.push_back(slot);
+
+		stats.uploads++;
+		stats.bytes += offset;
+		return texture;
+	}
+
+	// GL thread, call once per frame: slots whose copies have finished become free again
+	// never waits, a copy that's still running is checked again next time
+	void recycle() {
+		for (size_t i = 0; i < inFlight.size();) {
+			Slot& slot = slots[inFlight[i]];
+			GLenum status = glClientWaitSync(slot.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				++i;
+				continue;
+			}
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+			if (!persistentlyMapped) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer.id());
+				slot.memory = map();
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			if (slot.memory) {
+				freeSlots.tryPush(inFlight[i]);
+			}
+			inFlight[i] = inFlight.back();
+			inFlight.pop_back();
+		}
+	}
+
+	Stats getStats() const {
+		Stats current = stats;
+		current.waitsForSlot = slotWaits.load();
+		return current;
+	}
+
+private:
+	struct Slot {
+		GLBuffer buffer;
+		unsigned char* memory = nullptr; // null while the GL owns the buffer (unmapped)
+		GLsync fence = 0;
+	};
+
+	size_t slotSize;
+	bool persistentlyMapped = false;
+	std::vector<Slot> slots;
+	LockFreeQueue<int> freeSlots; // any thread
+	std::vector<int> inFlight;    // GL thread only, copies that may still be reading their slot
+	Stats stats; // GL thread only
+	std::atomic<unsigned int> slotWaits{ 0 };
+
+	// GL thread, the buffer bound to GL_PIXEL_UNPACK_BUFFER
+	// the fence already passed, so there's nothing to synchronize with
+	unsigned char* map() {
+		return (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)slotSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	}
+};
+
+#endif
@@ -0,0 +1,224 @@
+#pragma once
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// on-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary)
+// entries are keyed by a hash of the shader sources plus the driver vendor,
+// renderer and version strings so a driver update simply misses the cache
+// keyFor/load/store may run on any thread with a context current (ShaderWatcher builds
+// reloads on its own shared context), they serialize on a mutex
+class ProgramBinaryCache {
+public:
+	struct Stats {
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int rejected = 0; // file found but the driver refused the binary
+		double msSaved = 0.0;      // compile+link time recorded at store minus load time
+	};
+
+	static ProgramBinaryCache& instance() {
+		static ProgramBinaryCache cache;
+		return cache;
+	}
+
+	void setDirectory(const std::string& path) {
+		directory = path;
+		directoryCreated = false;
+	}
+
+	// the cache quietly turns itself off if the context can't hand out binaries
+	bool enabled() const {
+		return allowed && glExt().programBinary;
+	}
+
+	// switch the cache off, e.g. to time real compiles
+	void setEnabled(bool enable) {
+		allowed = enable;
+	}
+
+	// needs a current context the first time, the driver strings are part of the key
+	unsigned long long keyFor(const std::string& vertexCode, const std::string& fragmentCode) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (driverHash == 0) {
+			unsigned long long hash = FNV_OFFSET;
+			hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+			hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+			hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+			driverHash = hash;
+		}
+		unsigned long long hash = driverHash;
+		hash = hashBytes(hash, vertexCode.data(), vertexCode.size() + 1); // include the terminator as a separator
+		hash = hashBytes(hash, fragmentCode.data(), fragmentCode.size() + 1);
+		return hash;
+	}
+
+	// must be called before glLinkProgram or the driver may not keep a retrievable binary
+	void prepareForLink(GLuint program) {
+		if (enabled()) {
+			glExt().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// try to link `program` straight from a cached binary, false means compile from source
+	bool load(GLuint program, unsigned long long key) {
+		if (!enabled()) {
+			return false;
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::lock_guard<std::mutex> lock(mutex);
+
+		FILE* file = std::fopen(pathFor(key).c_str(), "rb");
+		if (!file) {
+			stats.misses++;
+			return false;
+		}
+		EntryHeader header;
+		std::vector<char> binary;
+		bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+			&& header.magic == MAGIC && header.key == key;
+		if (ok) {
+			// a damaged or foreign file mustn't make us allocate whatever its header claims
+			long dataStart = std::ftell(file);
+			ok = dataStart >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+			long fileEnd = ok ? std::ftell(file) : -1;
+			ok = ok && fileEnd >= dataStart && std::fseek(file, dataStart, SEEK_SET) == 0
+				&& header.length > 0 && header.length <= MAX_BINARY_LENGTH && header.length <= (unsigned long)(fileEnd - dataStart);
+		}
+		if (ok) {
+			binary.resize(header.length);
+			ok = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		std::fclose(file);
+		if (!ok) {
+			stats.misses++;
+			return false;
+		}
+
+		glExt().ProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			// stale binary (driver update with identical strings, etc.), fall back to source
+			stats.misses++;
+			stats.rejected++;
+			return false;
+		}
+
+		double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		stats.hits++;
+		if (header.compileMs > loadMs) {
+			stats.msSaved += header.compileMs - loadMs;
+		}
+		return true;
+	}
+
+	// write the binary of a freshly linked program, compileMs is what a future hit saves
+	void store(GLuint program, unsigned long long key, double compileMs) {
+		if (!enabled()) {
+			return;
+		}
+		int length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
+		}
+		std::vector<char> binary(length);
+		EntryHeader header;
+		header.key = key;
+		header.compileMs = compileMs;
+		glExt().GetProgramBinary(program, length, NULL, &header.format, binary.data());
+		header.length = (unsigned int)length;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		ensureDirectory();
+		FILE* file = std::fopen(pathFor(key).c_str(), "wb");
+		if (!file) {
+			std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED " << pathFor(key) << std::endl;
+			return;
+		}
+		std::fwrite(&header, sizeof(header), 1, file);
+		std::fwrite(binary.data(), 1, binary.size(), file);
+		std::fclose(file);
+	}
+
+	const Stats& getStats() const {
+		return stats;
+	}
+
+	void printStats() const {
+		std::cout << "program binary cache: " << stats.hits << " hits, " << stats.misses << " misses";
+		if (stats.rejected) {
+			std::cout << " (" << stats.rejected << " rejected by driver)";
+		}
+		std::cout << ", saved " << stats.msSaved << " ms" << std::endl;
+	}
+
+private:
+	static const unsigned int MAGIC = 0x42504C47; // "GLPB"
+	static const unsigned int MAX_BINARY_LENGTH = 64 * 1024 * 1024; // far beyond any real program
+	static const unsigned long long FNV_OFFSET = 14695981039346656037ull;
+	static const unsigned long long FNV_PRIME = 1099511628211ull;
+
+	struct EntryHeader {
+		unsigned int magic = MAGIC;
+		GLenum format = 0;
+		unsigned int length = 0;
+		double compileMs = 0.0;
+		unsigned long long key = 0;
+	};
+
+	std::string directory = "./shader_cache";
+	bool directoryCreated = false;
+	bool allowed = true;
+	unsigned long long driverHash = 0;
+	Stats stats;
+	std::mutex mutex; // guards driverHash, stats and the files
+
+	ProgramBinaryCache() {}
+
+	static unsigned long long hashBytes(unsigned long long hash, const char* data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+	static unsigned long long hashString(unsigned long long hash, const char* str) {
+		return str ? hashBytes(hash, str, std::strlen(str) + 1) : hash;
+	}
+
+	std::string pathFor(unsigned long long key) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "/%016llx.bin", key);
+		return directory + name;
+	}
+
+	void ensureDirectory() {
+		if (directoryCreated) {
+			return;
+		}
+		// fails harmlessly when it already exists
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+		directoryCreated = true;
+	}
+};
+
+#endif
@@ -3,11 +3,67 @@
 #define SHADER_H
 
 #include <glad/glad.h> // get all OpenGL headers
+#include "./ProgramBinaryCache.h"
+#include "./ShaderPreprocessor.h"
+#include "./UniformBuffer.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./ShaderReflection.h"
 
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <vector>
+#include <cstddef>
+#include <memory>
+#include <chrono>
 #include <iostream>
+#include <type_traits>
+#include <utility>
+
+// FNV-1a over a uniform name, constexpr so literal names hash at compile time
+constexpr unsigned int uniformHash(const char* name) {
+	unsigned int hash = 2166136261u;
+	for (; *name; ++name) {
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	}
+	return hash;
+}
+
+// uniform name paired with its hash
+// literals convert implicitly and hash at compile time, std::strings hash at runtime
+struct UniformName {
+	const char* name;
+	unsigned int hash;
+
+	template <std::size_t N>
+	constexpr UniformName(const char (&literal)[N]) : name(literal), hash(uniformHash(literal)) {}
+	constexpr UniformName(const char* name, unsigned int hash) : name(name), hash(hash) {}
+	UniformName(const std::string& runtimeName) : name(runtimeName.c_str()), hash(uniformHash(runtimeName.c_str())) {}
+};
+
+// forces the hash into a constant expression even in unoptimized builds
+#define UNIFORM(literal) UniformName(literal, std::integral_constant<unsigned int, uniformHash(literal)>::value)
+
+// handle to a uniform location that was resolved once after linking
+// pass these to the setters to skip the name lookup entirely
+struct UniformHandle {
+	int location = -1;
+
+	bool valid() const { return location >= 0; }
+};
+
+// when a Shader checks the results of its compile/link
+// Deferred submits the work and only waits on the driver when the program is first used,
+// so many programs can compile at once (see ShaderBatch)
+enum class ShaderBuild {
+	Now,
+	Deferred,
+};
+
+// GLSL text handed to Shader directly instead of file paths
+struct ShaderSourceCode {
+	std::string vertex;
+	std::string fragment;
+};
 
 class Shader {
 public:
@@ -15,48 +71,353 @@ public:
 	unsigned int ID;
 
 	// constructor to read and build shader from GLSL sources
-	Shader(const char* vertexPath, const char* fragmentPath) {
+	Shader(const char* vertexPath, const char* fragmentPath, ShaderBuild build = ShaderBuild::Now)
+		: Shader(vertexPath, fragmentPath, ShaderDefines(), build) {
+	}
+
+	// same, but builds the permutation selected by `defines` (injected after #version)
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, ShaderBuild build = ShaderBuild::Now) {
 
 		// STEP 1: retrieve shader source codes from filePaths
-		// using C++ filestreams to read code into several strings
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-
-		// ensure ifstream objects can throw exceptions
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		try {
-			// open the files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			// read file buffer contents into streams
-			std::stringstream vShaderStream, fShaderStream;
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-		}
-		catch (std::ifstream::failure e) {
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		// the preprocessor resolves #includes, injects the defines and caches the result,
+		// so building a permutation we already expanded doesn't touch the disk
+		ShaderPreprocessor& preprocessor = ShaderPreprocessor::instance();
+		std::shared_ptr<const ExpandedShaderSource> vertexSource = preprocessor.expand(vertexPath, defines);
+		std::shared_ptr<const ExpandedShaderSource> fragmentSource = preprocessor.expand(fragmentPath, defines);
+
+		this->vertexPath = vertexPath;
+		this->fragmentPath = fragmentPath;
+		this->defines = defines;
+		setDependencies(vertexSource, fragmentSource);
+		submit(vertexSource ? vertexSource->code : std::string(), fragmentSource ? fragmentSource->code : std::string());
+		if (build == ShaderBuild::Now) {
+			finish();
+		}
+	}
+
+	// build from GLSL text that didn't come from a file
+	explicit Shader(const ShaderSourceCode& source, ShaderBuild build = ShaderBuild::Now) {
+		submit(source.vertex, source.fragment);
+		if (build == ShaderBuild::Now) {
+			finish();
+		}
+	}
+
+	// destructor 
+	// the program and any in-flight shader objects are owned by GLObject members,
+	// so Shader is move-only and never deletes the same program twice
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	Shader(Shader&&) = default;
+	Shader& operator=(Shader&&) = default;
+
+	// true until finish() has checked the results of a deferred build
+	bool pending() const {
+		return build.pending;
+	}
+
+	// non-blocking check whether finish() would return without waiting on the driver
+	bool ready() const {
+		return buildReady(build);
+	}
+
+	// STEP 3: wait for compile/link, report errors, cache the binary and reflect uniforms
+	// called automatically by use(), cheap when nothing is pending
+	void finish() {
+		if (!build.pending) {
+			return;
 		}
+		finishBuild(build);
+		// STEP 4: record the active inputs, uniforms, samplers and blocks so nothing has to
+		// ask the driver again, and point samplers/blocks at their units/bindings
+		reflectProgram();
+	}
+
+	// files this shader was read from, empty when built from ShaderSourceCode
+	const std::string& getVertexPath() const {
+		return vertexPath;
+	}
+	const std::string& getFragmentPath() const {
+		return fragmentPath;
+	}
+	const ShaderDefines& getDefines() const {
+		return defines;
+	}
+	// both source files and everything they #include
+	const std::vector<std::string>& getDependencies() const {
+		return dependencies;
+	}
+
+	// attributes, uniforms, sampler units and uniform blocks of the current program
+	// empty for a deferred build until finish()/use(), rebuilt whenever a reload swaps programs
+	const ShaderReflection& reflection() const {
+		return programReflection;
+	}
+
+	// pin a sampler to a texture unit, applied right away and again after every reload
+	// samplers nobody pinned get the lowest free units in name order (texture0 -> 0, texture1 -> 1),
+	// so there's no need to setInt() them every frame
+	void setSamplerUnit(const std::string& name, int unit) {
+		bool known = false;
+		for (std::pair<std::string, int>& pinned : pinnedSamplerUnits) {
+			if (pinned.first == name) {
+				pinned.second = unit;
+				known = true;
+			}
+		}
+		if (!known) {
+			pinnedSamplerUnits.push_back(std::make_pair(name, unit));
+		}
+		if (!build.pending) {
+			bindSamplers();
+		}
+	}
+
+	// texture unit to bind `name`'s texture to, -1 if the program doesn't sample it
+	int samplerUnit(const std::string& name) const {
+		const ShaderSampler* sampler = programReflection.sampler(name);
+		return sampler ? sampler->unit : -1;
+	}
+
+	// bumped every time a reload swaps in a new program
+	// locations can move, so re-resolve any cached UniformHandle when this changes
+	unsigned int generation() const {
+		return programGeneration;
+	}
+
+	// start compiling replacement sources next to the live program (used by ShaderWatcher)
+	// nothing waits on the driver here and the current program keeps rendering meanwhile
+	void beginReload(const std::shared_ptr<const ExpandedShaderSource>& vertexSource, const std::shared_ptr<const ExpandedShaderSource>& fragmentSource) {
+		setDependencies(vertexSource, fragmentSource);
+		reloadBuild = submitBuild(vertexSource->code, fragmentSource->code);
+	}
+
+	bool reloading() const {
+		return reloadBuild.program.id() != 0;
+	}
+
+	// call between frames, swaps the new program in once it is done linking
+	// a failed compile/link keeps the old program and throws the new one away
+	// without KHR_parallel_shader_compile this waits for the driver on the first call
+	// returns true when the program changed
+	bool pollReload() {
+		if (!reloading() || !buildReady(reloadBuild)) {
+			return false;
+		}
+		// a binary cache hit arrives already linked
+		if (reloadBuild.pending && !finishBuild(reloadBuild)) {
+			std::cout << "ERROR::SHADER::RELOAD_FAILED keeping the previous program for "
+				<< vertexPath << " + " << fragmentPath << std::endl;
+			reloadBuild = ProgramBuild();
+			return false;
+		}
+		ProgramBuild replacement = std::move(reloadBuild);
+		reloadBuild = ProgramBuild();
+		swapIn(std::move(replacement));
+		return true;
+	}
+
+	// compiles and links on the calling thread, which has to have a context current that shares
+	// objects with the one drawing (ShaderWatcher's hidden one), and waits for the driver there
+	// returns the linked program for adoptReload(), 0 (with the errors printed) if it failed
+	static GLuint buildShared(const std::string& vertexCode, const std::string& fragmentCode) {
+		ProgramBuild result = submitBuild(vertexCode, fragmentCode);
+		// a binary cache hit arrives already linked
+		if (result.pending && !finishBuild(result)) {
+			// never bound anywhere, so there's nothing for glState() to forget
+			glDeleteProgram(result.program.release());
+			return 0;
+		}
+		// another context is only guaranteed to see the linked program once its commands completed
+		glFinish();
+		return result.program.release();
+	}
+
+	// GL thread, between frames: takes over a program buildShared() linked and swaps it in,
+	// dropping any reload still compiling here since those sources are older
+	void adoptReload(GLuint program, const std::shared_ptr<const ExpandedShaderSource>& vertexSource, const std::shared_ptr<const ExpandedShaderSource>& fragmentSource) {
+		setDependencies(vertexSource, fragmentSource);
+		reloadBuild = ProgramBuild();
+		ProgramBuild replacement;
+		replacement.program.reset(program);
+		swapIn(std::move(replacement));
+	}
+
+	// use/activate shader
+	void use() {
+		finish();
+		glState().useProgram(ID); // nothing to do if it's already current
+	}
+
+	// look up a uniform in the table built after linking (no GL call, no allocation)
+	// unknown or optimized-out names give an invalid handle, which glUniform* ignores
+	// a deferred build has no table until finish()/use(), so resolve handles after that
+	UniformHandle uniform(const UniformName& name) const {
+		UniformHandle handle;
+		if (!uniformSlots.empty()) {
+			unsigned int mask = (unsigned int)uniformSlots.size() - 1;
+			for (unsigned int i = name.hash & mask; uniformSlots[i].location >= 0; i = (i + 1) & mask) {
+				const UniformSlot& slot = uniformSlots[i];
+				// hashes of the active uniforms are unique unless reflectUniforms() said otherwise
+				if (slot.hash == name.hash && (!uniformHashCollision || slot.name == name.name)) {
+#ifndef NDEBUG
+					if (slot.name != name.name) {
+						break; // a missing name that happens to share a hash
+					}
+#endif
+					handle.location = slot.location;
+					break;
+				}
+			}
+		}
+#ifndef NDEBUG
+		if (!handle.valid()) {
+			reportMissingUniform(name);
+		}
+#endif
+		return handle;
+	}
+
+	// utility uniform functions
+	void setBool(UniformHandle handle, bool value) const {
+		glUniform1i(handle.location, (int)value);
+	}
+	void setInt(UniformHandle handle, int value) const {
+		glUniform1i(handle.location, value);
+	}
+	void setFloat(UniformHandle handle, float value) const {
+		glUniform1f(handle.location, value);
+	}
+	void setColor(UniformHandle handle, float red, float green, float blue, float alpha) const {
+		glUniform4f(handle.location, red, green, blue, alpha);
+	}
+	void setVec4(UniformHandle handle, float x, float y, float z, float w) const {
+		glUniform4f(handle.location, x, y, z, w);
+	}
+
+	// by-name versions, a string literal becomes a UniformName with its hash already known
+	void setBool(const UniformName& name, bool value) const {
+		setBool(uniform(name), value);
+	}
+	void setInt(const UniformName& name, int value) const {
+		setInt(uniform(name), value);
+	}
+	void setFloat(const UniformName& name, float value) const {
+		setFloat(uniform(name), value);
+	}
+	void setColor(const UniformName& name, float red, float green, float blue, float alpha) const {
+		setColor(uniform(name), red, green, blue, alpha);
+	}
+	void setVec4(const UniformName& name, float x, float y, float z, float w) const {
+		setVec4(uniform(name), x, y, z, w);
+	}
+
+private:
+	// one compile+link, the shader objects stay alive until it's checked so we can read their logs
+	struct ProgramBuild {
+		GLProgram program;
+		GLShaderObject vertexShader;
+		GLShaderObject fragmentShader;
+		bool pending = false;
+		unsigned long long cacheKey = 0;
+		std::chrono::steady_clock::time_point start;
+	};
+	ProgramBuild build;       // the program behind ID
+	ProgramBuild reloadBuild; // its replacement while a hot reload compiles
+	std::string vertexPath;
+	std::string fragmentPath;
+	ShaderDefines defines;
+	std::vector<std::string> dependencies;
+	unsigned int programGeneration = 0;
+	ShaderReflection programReflection;
+	std::vector<std::pair<std::string, int>> pinnedSamplerUnits; // setSamplerUnit() calls, kept for reloads
+
+	void setDependencies(const std::shared_ptr<const ExpandedShaderSource>& vertexSource, const std::shared_ptr<const ExpandedShaderSource>& fragmentSource) {
+		dependencies.clear();
+		if (vertexSource) {
+			dependencies = vertexSource->dependencies;
+		}
+		if (fragmentSource) {
+			for (const std::string& file : fragmentSource->dependencies) {
+				if (std::find(dependencies.begin(), dependencies.end(), file) == dependencies.end()) {
+					dependencies.push_back(file);
+				}
+			}
+		}
+	}
+
+	// a linked and checked program replaces the current one, uniforms are looked up again
+	void swapIn(ProgramBuild&& replacement) {
+		finish(); // never swap out a build that hasn't been checked yet
+		build = std::move(replacement); // deletes the old program
+		ID = build.program.id();
+		programGeneration++;
+		reflectProgram();
+	}
+
+	// STEP 2: hand everything to the driver without asking for any results
+	void submit(const std::string& vertexCode, const std::string& fragmentCode) {
+		build = submitBuild(vertexCode, fragmentCode);
+		ID = build.program.id();
+		if (!build.pending) {
+			reflectProgram(); // came straight out of the binary cache
+		}
+	}
+
+	// querying a status right after glCompileShader/glLinkProgram forces the driver to finish first
+	static ProgramBuild submitBuild(const std::string& vertexCode, const std::string& fragmentCode) {
+		ProgramBuild result;
+
+		// reuse a previously linked binary of the exact same sources if we have one
+		ProgramBinaryCache& binaryCache = ProgramBinaryCache::instance();
+		result.cacheKey = binaryCache.enabled() ? binaryCache.keyFor(vertexCode, fragmentCode) : 0;
+		result.program = GLProgram::create();
+		GLuint program = result.program.id();
+		if (binaryCache.load(program, result.cacheKey)) {
+			return result;
+		}
+		result.start = std::chrono::steady_clock::now();
+
 		// our shader source code as C-strings (arrays of char):
 		const char* vShaderCode = vertexCode.c_str();
 		const char* fShaderCode = fragmentCode.c_str();
 
-		// STEP 2: compile shaders
-		unsigned int vertex, fragment;
-		int success;
-		char infoLog[512];
-
-		vertex = glCreateShader(GL_VERTEX_SHADER);
+		result.vertexShader = GLShaderObject::create(GL_VERTEX_SHADER);
+		GLuint vertex = result.vertexShader.id();
 		glShaderSource(vertex, 1, &vShaderCode, NULL);
 		glCompileShader(vertex);
+		result.fragmentShader = GLShaderObject::create(GL_FRAGMENT_SHADER);
+		GLuint fragment = result.fragmentShader.id();
+		glShaderSource(fragment, 1, &fShaderCode, NULL);
+		glCompileShader(fragment);
+
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		binaryCache.prepareForLink(program);
+		glLinkProgram(program);
+		result.pending = true;
+		return result;
+	}
+
+	// without KHR_parallel_shader_compile we can't ask, so we always say yes
+	static bool buildReady(const ProgramBuild& pending) {
+		if (!pending.pending || !glExt().parallelShaderCompile) {
+			return true;
+		}
+		int complete = 0;
+		glGetProgramiv(pending.program.id(), GL_COMPLETION_STATUS_KHR, &complete);
+		return complete != 0;
+	}
+
+	// returns the link status, the program object is kept either way
+	static bool finishBuild(ProgramBuild& pending) {
+		pending.pending = false;
+
+		GLuint program = pending.program.id();
+		GLuint vertex = pending.vertexShader.id();
+		GLuint fragment = pending.fragmentShader.id();
+		int success;
+		char infoLog[512];
 		// check for any errors
 		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
 		if (!success)
@@ -64,58 +425,178 @@ public:
 			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
 		};
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		// check for any errors
 		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
 		if (!success)
 		{
 			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
 		};
-
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		glLinkProgram(ID);
 		// check for any linking errors
-		glGetProgramiv(ID, GL_LINK_STATUS, &success);
-		if (!success)
+		int linked;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
 		{
-			glGetProgramInfoLog(ID, 512, NULL, infoLog);
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 		}
+		else {
+			// for deferred builds this includes however long the program sat unused
+			double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.start).count();
+			ProgramBinaryCache::instance().store(program, pending.cacheKey, compileMs);
+		}
 
 		// delete the shaders
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		pending.vertexShader.reset();
+		pending.fragmentShader.reset();
+		return linked != 0;
 	}
 
-	// destructor 
-	~Shader() {
-		glDeleteProgram(ID);
+	// one entry of the open-addressed uniform table, location -1 marks an empty slot
+	struct UniformSlot {
+		unsigned int hash = 0;
+		int location = -1;
+		std::string name;
+	};
+	std::vector<UniformSlot> uniformSlots; // size is always a power of two
+	bool uniformHashCollision = false; // two active names share a hash, compare names too
+#ifndef NDEBUG
+	mutable std::vector<unsigned int> reportedUniforms; // only complain once per name
+#endif
+
+	void insertUniform(const std::string& name, int location) {
+		UniformSlot slot;
+		slot.hash = uniformHash(name.c_str());
+		slot.location = location;
+		slot.name = name;
+		unsigned int mask = (unsigned int)uniformSlots.size() - 1;
+		unsigned int i = slot.hash & mask;
+		while (uniformSlots[i].location >= 0) {
+			if (uniformSlots[i].hash == slot.hash) {
+				uniformHashCollision = true;
+			}
+			i = (i + 1) & mask;
+		}
+		uniformSlots[i] = slot;
 	}
 
-	// use/activate shader
-	void use() {
-		glUseProgram(ID);
+	void reflectProgram() {
+		programReflection = ShaderReflection::of(ID);
+		buildUniformTable();
+		bindUniformBlocks();
+		bindSamplers();
+	}
 
+	// point every uniform block at the binding its name was given by UniformBlockBindings
+	// (a block that didn't get one keeps its default binding, which pointFor() reported)
+	void bindUniformBlocks() {
+		for (ShaderUniformBlock& block : programReflection.blocks) {
+			block.binding = UniformBlockBindings::pointFor(block.name);
+			if (block.binding != UniformBlockBindings::NO_POINT) {
+				glUniformBlockBinding(ID, block.index, block.binding);
+			}
+		}
 	}
 
-	// utility uniform functions
-	void setBool(const std::string &name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	// sampler values are program state, so setting them once here lasts until the next link
+	void bindSamplers() {
+		std::vector<ShaderSampler>& samplers = programReflection.samplers;
+		if (samplers.empty()) {
+			return;
+		}
+		std::vector<bool> taken;
+		for (ShaderSampler& sampler : samplers) {
+			sampler.unit = -1;
+			for (const std::pair<std::string, int>& pinned : pinnedSamplerUnits) {
+				if (pinned.first == sampler.name) {
+					sampler.unit = pinned.second;
+				}
+			}
+			if (sampler.unit >= 0) {
+				markUnits(taken, sampler.unit, sampler.size);
+			}
+		}
+		for (ShaderSampler& sampler : samplers) {
+			if (sampler.unit >= 0) {
+				continue;
+			}
+			int unit = 0;
+			while (!unitsFree(taken, unit, sampler.size)) {
+				unit++;
+			}
+			sampler.unit = unit;
+			markUnits(taken, unit, sampler.size);
+		}
+
+		// glUniform* writes to the current program, put the caller's back afterwards
+		GLint previous = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+		glUseProgram(ID);
+		std::vector<GLint> units;
+		for (const ShaderSampler& sampler : samplers) {
+			units.clear();
+			for (int i = 0; i < sampler.size; ++i) {
+				units.push_back(sampler.unit + i);
+			}
+			glUniform1iv(sampler.location, (GLsizei)units.size(), units.data());
+		}
+		glUseProgram((GLuint)previous);
 	}
-	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+
+	static bool unitsFree(const std::vector<bool>& taken, int first, int count) {
+		for (int unit = first; unit < first + count; ++unit) {
+			if (unit < (int)taken.size() && taken[unit]) {
+				return false;
+			}
+		}
+		return true;
 	}
-	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	static void markUnits(std::vector<bool>& taken, int first, int count) {
+		if ((int)taken.size() < first + count) {
+			taken.resize(first + count, false);
+		}
+		for (int unit = first; unit < first + count; ++unit) {
+			taken[unit] = true;
+		}
 	}
-	void setColor(const std::string& name, float red, float green, float blue, float alpha) {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), red, green, blue, alpha);
+
+	// hash the locations of the reflected uniforms for uniform()
+	void buildUniformTable() {
+		uniformSlots.clear();
+		uniformHashCollision = false;
+		const std::vector<ShaderUniform>& uniforms = programReflection.uniforms;
+		if (uniforms.empty()) {
+			return;
+		}
+
+		// keep the load factor at or below 1/2 (arrays get a second "name[0]" entry)
+		unsigned int capacity = 8;
+		while (capacity < (unsigned int)uniforms.size() * 4) {
+			capacity <<= 1;
+		}
+		uniformSlots.resize(capacity);
+
+		for (const ShaderUniform& uniform : uniforms) {
+			insertUniform(uniform.name, uniform.location);
+			// arrays are reported as "name[0]", also accept the bare name like GL does
+			size_t bracket = uniform.name.rfind("[0]");
+			if (bracket != std::string::npos && bracket + 3 == uniform.name.size()) {
+				insertUniform(uniform.name.substr(0, bracket), uniform.location);
+			}
+		}
+	}
+
+#ifndef NDEBUG
+	void reportMissingUniform(const UniformName& name) const {
+		for (unsigned int hash : reportedUniforms) {
+			if (hash == name.hash) {
+				return;
+			}
+		}
+		reportedUniforms.push_back(name.hash);
+		std::cout << "ERROR::SHADER::UNIFORM_NOT_FOUND \"" << name.name
+			<< "\" is not an active uniform of program " << ID << std::endl;
 	}
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./Shader.h"
+
+#include <memory>
+#include <vector>
+
+// compiles many programs concurrently
+// every add() only submits work to the driver, nothing waits until a program is
+// first used (Shader::use) or finish() is called, so with KHR_parallel_shader_compile
+// the driver spreads the whole batch over its compiler threads
+class ShaderBatch {
+public:
+	// 0xFFFFFFFF lets the driver pick the thread count
+	explicit ShaderBatch(unsigned int compilerThreads = 0xFFFFFFFF) {
+		if (glExt().parallelShaderCompile) {
+			glExt().MaxShaderCompilerThreads(compilerThreads);
+		}
+	}
+
+	// the returned reference stays valid for the lifetime of the batch
+	Shader& add(const char* vertexPath, const char* fragmentPath) {
+		shaders.push_back(std::unique_ptr<Shader>(new Shader(vertexPath, fragmentPath, ShaderBuild::Deferred)));
+		return *shaders.back();
+	}
+	Shader& add(const ShaderSourceCode& source) {
+		shaders.push_back(std::unique_ptr<Shader>(new Shader(source, ShaderBuild::Deferred)));
+		return *shaders.back();
+	}
+
+	size_t size() const {
+		return shaders.size();
+	}
+	Shader& operator[](size_t i) {
+		return *shaders[i];
+	}
+
+	// non-blocking, only meaningful with KHR_parallel_shader_compile (always true otherwise)
+	size_t readyCount() const {
+		size_t count = 0;
+		for (const std::unique_ptr<Shader>& shader : shaders) {
+			if (shader->ready()) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	// finish whatever already completed, e.g. once per frame during a loading screen
+	void finishReady() {
+		for (std::unique_ptr<Shader>& shader : shaders) {
+			if (shader->pending() && shader->ready()) {
+				shader->finish();
+			}
+		}
+	}
+
+	// block until every program is linked and checked
+	void finish() {
+		for (std::unique_ptr<Shader>& shader : shaders) {
+			shader->finish();
+		}
+	}
+
+private:
+	std::vector<std::unique_ptr<Shader>> shaders;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#pragma once
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./Shader.h"
+#include "./ShaderPreprocessor.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <iostream>
+
+// compiled variants of a set of base shaders, one program per (base shader, feature bitmask)
+// feature bit i of a base turns on the i-th define it was registered with
+// variants compile lazily on first request or ahead of time with prewarm(), and the least
+// recently used ones are deleted once there are more than maxPrograms of them or their
+// estimated size passes the memory budget
+class ShaderPermutations {
+public:
+	struct Stats {
+		unsigned int requests = 0;
+		unsigned int compiles = 0;
+		unsigned int evictions = 0;
+		size_t programs = 0;
+		size_t bytes = 0;
+	};
+
+	// 0 means no limit
+	explicit ShaderPermutations(size_t maxPrograms = 0, size_t memoryBudget = 0)
+		: maxPrograms(maxPrograms), memoryBudget(memoryBudget) {
+	}
+
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+	// returns the id to pass to get()/prewarm(), up to 64 features per base
+	int addBase(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& featureDefines) {
+		Base base;
+		base.vertexPath = vertexPath;
+		base.fragmentPath = fragmentPath;
+		base.features = featureDefines;
+		bases.push_back(base);
+		return (int)bases.size() - 1;
+	}
+
+	void setMaxPrograms(size_t count) {
+		maxPrograms = count;
+		evict();
+	}
+	void setMemoryBudget(size_t bytes) {
+		memoryBudget = bytes;
+		evict();
+	}
+
+	// call once per frame, programs handed out during the current frame are never evicted
+	void beginFrame() {
+		frame++;
+		evict();
+	}
+
+	// the variant ready to use, compiles it right now (and waits) if it doesn't exist yet
+	Shader& get(int base, unsigned long long features) {
+		Entry& entry = touch(base, features, ShaderBuild::Now);
+		finishEntry(entry);
+		return *entry.shader;
+	}
+
+	// never waits: starts a deferred compile if needed and returns null until it has linked,
+	// so the caller can draw with a fallback variant instead of hitching
+	Shader* tryGet(int base, unsigned long long features) {
+		Entry& entry = touch(base, features, ShaderBuild::Deferred);
+		if (entry.shader->pending() && !entry.shader->ready()) {
+			return nullptr;
+		}
+		finishEntry(entry);
+		return entry.shader.get();
+	}
+
+	// submit a declared set of variants without waiting, e.g. while a loading screen is up
+	// keep calling finishReady() each frame, or get() will wait for whatever is left
+	void prewarm(int base, const std::vector<unsigned long long>& featureSets) {
+		for (unsigned long long features : featureSets) {
+			touch(base, features, ShaderBuild::Deferred);
+		}
+	}
+
+	// finishes every submitted variant that the driver is done with, returns how many are still compiling
+	size_t finishReady() {
+		size_t stillPending = 0;
+		for (Entry& entry : lru) {
+			if (!entry.shader->pending()) {
+				continue;
+			}
+			if (entry.shader->ready()) {
+				finishEntry(entry);
+			}
+			else {
+				stillPending++;
+			}
+		}
+		return stillPending;
+	}
+
+	const Stats& getStats() const {
+		return stats;
+	}
+
+	void printStats() const {
+		std::cout << "shader permutations: " << stats.programs << " programs (" << stats.bytes / 1024 << " KB), "
+			<< stats.requests << " requests, " << stats.compiles << " compiles, " << stats.evictions << " evictions" << std::endl;
+	}
+
+private:
+	struct Base {
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::vector<std::string> features;
+	};
+	typedef std::pair<int, unsigned long long> Key;
+	struct Entry {
+		Key key;
+		std::unique_ptr<Shader> shader;
+		size_t bytes = 0; // 0 until the build is finished
+		unsigned long long lastFrame = 0;
+	};
+
+	std::vector<Base> bases;
+	std::list<Entry> lru; // most recently used first
+	std::map<Key, std::list<Entry>::iterator> entries;
+	size_t maxPrograms;
+	size_t memoryBudget;
+	unsigned long long frame = 0;
+	Stats stats;
+
+	Entry& touch(int base, unsigned long long features, ShaderBuild build) {
+		stats.requests++;
+		Key key(base, features);
+		std::map<Key, std::list<Entry>::iterator>::iterator found = entries.find(key);
+		if (found != entries.end()) {
+			lru.splice(lru.begin(), lru, found->second);
+			lru.front().lastFrame = frame;
+			return lru.front();
+		}
+
+		const Base& source = bases[base];
+		ShaderDefines defines;
+		for (size_t bit = 0; bit < source.features.size() && bit < 64; ++bit) {
+			if (features & (1ull << bit)) {
+				defines.add(source.features[bit]);
+			}
+		}
+
+		lru.push_front(Entry());
+		Entry& entry = lru.front();
+		entry.key = key;
+		entry.lastFrame = frame;
+		entry.shader.reset(new Shader(source.vertexPath.c_str(), source.fragmentPath.c_str(), defines, build));
+		entries[key] = lru.begin();
+		stats.compiles++;
+		stats.programs = lru.size();
+		if (!entry.shader->pending()) {
+			finishEntry(entry);
+		}
+		evict();
+		return entry;
+	}
+
+	void finishEntry(Entry& entry) {
+		if (entry.bytes != 0) {
+			return;
+		}
+		entry.shader->finish();
+		entry.bytes = programBytes(*entry.shader);
+		stats.bytes += entry.bytes; // the budget is enforced on the next touch()/beginFrame()
+	}
+
+	// the driver's binary size is the best estimate we can get of what a program costs
+	static size_t programBytes(const Shader& shader) {
+		int length = 0;
+		if (glExt().programBinary) {
+			glGetProgramiv(shader.ID, GL_PROGRAM_BINARY_LENGTH, &length);
+		}
+		return length > 0 ? (size_t)length : 16 * 1024;
+	}
+
+	bool overBudget() const {
+		return (maxPrograms && lru.size() > maxPrograms) || (memoryBudget && stats.bytes > memoryBudget);
+	}
+
+	void evict() {
+		while (overBudget() && !lru.empty()) {
+			Entry& victim = lru.back();
+			if (victim.lastFrame == frame) {
+				break; // everything left is in use this frame
+			}
+			stats.bytes -= victim.bytes;
+			stats.evictions++;
+			entries.erase(victim.key);
+			lru.pop_back();
+		}
+		stats.programs = lru.size();
+	}
+};
+
+#endif
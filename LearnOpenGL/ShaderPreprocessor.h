@@ -0,0 +1,283 @@
+#pragma once
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+// #defines injected into a shader right after its #version line
+// every distinct set of defines is one permutation of the shader, identified by key()
+class ShaderDefines {
+public:
+	ShaderDefines& add(const std::string& name, const std::string& value = "1") {
+		std::vector<std::pair<std::string, std::string>>::iterator at = std::lower_bound(defines.begin(), defines.end(),
+			std::make_pair(name, std::string()));
+		if (at != defines.end() && at->first == name) {
+			at->second = value;
+		}
+		else {
+			defines.insert(at, std::make_pair(name, value));
+		}
+		return *this;
+	}
+
+	bool empty() const {
+		return defines.empty();
+	}
+
+	// kept sorted by name so the same defines in any order are the same permutation
+	const std::vector<std::pair<std::string, std::string>>& list() const {
+		return defines;
+	}
+
+	// permutation key, 0 for no defines at all
+	unsigned long long key() const {
+		if (defines.empty()) {
+			return 0;
+		}
+		unsigned long long hash = 14695981039346656037ull;
+		for (const std::pair<std::string, std::string>& define : defines) {
+			hash = hashText(hash, define.first);
+			hash = hashText(hash, define.second);
+		}
+		return hash;
+	}
+
+	static unsigned long long hashText(unsigned long long hash, const std::string& text) {
+		// hash the terminator too so "ab"+"c" and "a"+"bc" differ
+		for (size_t i = 0; i <= text.size(); ++i) {
+			hash = (hash ^ (unsigned char)text.c_str()[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+private:
+	std::vector<std::pair<std::string, std::string>> defines;
+};
+
+// a fully expanded shader: includes pasted in, defines injected
+struct ExpandedShaderSource {
+	std::string code;
+	unsigned long long hash = 0;           // content hash of `code`
+	std::vector<std::string> dependencies; // the file itself plus everything it included
+};
+
+// resolves #include "file" (relative to the including file, each file pasted once per
+// expansion like #pragma once) and injects ShaderDefines
+// file contents and finished expansions are cached, so asking for a permutation that
+// was already built never touches the disk or re-expands anything
+// thread safe, the hot reload thread expands in the background
+class ShaderPreprocessor {
+public:
+	static ShaderPreprocessor& instance() {
+		static ShaderPreprocessor preprocessor;
+		return preprocessor;
+	}
+
+	// null if the top level file can't be read
+	std::shared_ptr<const ExpandedShaderSource> expand(const std::string& path, const ShaderDefines& defines = ShaderDefines()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		ExpansionKey key(normalize(path), defines.key());
+		std::map<ExpansionKey, std::shared_ptr<const ExpandedShaderSource>>::const_iterator cached = expansions.find(key);
+		if (cached != expansions.end()) {
+			return cached->second;
+		}
+
+		std::shared_ptr<ExpandedShaderSource> result = std::make_shared<ExpandedShaderSource>();
+		std::set<std::string> included;
+		if (!appendFile(path, 0, result->code, result->dependencies, included)) {
+			return nullptr;
+		}
+		injectDefines(result->code, defines);
+		result->hash = ShaderDefines::hashText(14695981039346656037ull, result->code);
+
+		// permutations that expand to identical text share one copy
+		std::map<unsigned long long, std::shared_ptr<const ExpandedShaderSource>>::const_iterator same = byHash.find(result->hash);
+		std::shared_ptr<const ExpandedShaderSource> shared = result;
+		if (same != byHash.end() && same->second->code == result->code) {
+			shared = same->second;
+		}
+		else {
+			byHash[result->hash] = shared;
+		}
+		expansions[key] = shared;
+		return shared;
+	}
+
+	// forget a file that changed on disk along with every expansion that used it
+	void invalidate(const std::string& path) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::string file = normalize(path);
+		files.erase(file);
+		for (std::map<ExpansionKey, std::shared_ptr<const ExpandedShaderSource>>::iterator it = expansions.begin(); it != expansions.end();) {
+			const std::vector<std::string>& dependencies = it->second->dependencies;
+			if (std::find(dependencies.begin(), dependencies.end(), file) != dependencies.end()) {
+				byHash.erase(it->second->hash);
+				it = expansions.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	// "a.glsl", "./a.glsl" and ".\a.glsl" all become "./a.glsl", also collapses "dir/../"
+	static std::string normalize(std::string path) {
+		std::replace(path.begin(), path.end(), '\\', '/');
+		std::vector<std::string> parts;
+		size_t start = 0;
+		bool absolute = !path.empty() && path[0] == '/';
+		while (start <= path.size()) {
+			size_t end = path.find('/', start);
+			if (end == std::string::npos) {
+				end = path.size();
+			}
+			std::string part = path.substr(start, end - start);
+			if (part == "..") {
+				if (!parts.empty() && parts.back() != "..") {
+					parts.pop_back();
+				}
+				else {
+					parts.push_back(part);
+				}
+			}
+			else if (!part.empty() && part != ".") {
+				parts.push_back(part);
+			}
+			start = end + 1;
+		}
+		std::string result = absolute ? "" : ".";
+		for (const std::string& part : parts) {
+			result += "/" + part;
+		}
+		return result;
+	}
+
+private:
+	typedef std::pair<std::string, unsigned long long> ExpansionKey; // normalized path, defines key
+
+	std::mutex mutex;
+	std::map<std::string, std::string> files; // normalized path -> raw text
+	std::map<ExpansionKey, std::shared_ptr<const ExpandedShaderSource>> expansions;
+	std::map<unsigned long long, std::shared_ptr<const ExpandedShaderSource>> byHash;
+
+	ShaderPreprocessor() {}
+
+	// caller holds the mutex
+	const std::string* readFile(const std::string& file) {
+		std::map<std::string, std::string>::const_iterator cached = files.find(file);
+		if (cached != files.end()) {
+			return &cached->second;
+		}
+		std::ifstream stream(file);
+		if (!stream) {
+			return nullptr;
+		}
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		return &(files[file] = contents.str());
+	}
+
+	static std::string directoryOf(const std::string& file) {
+		size_t slash = file.rfind('/');
+		return slash == std::string::npos ? "." : file.substr(0, slash);
+	}
+
+	// pulls the file name out of `#include "name"` / `#include <name>`, false for any other line
+	static bool parseInclude(const std::string& line, std::string& name) {
+		size_t at = line.find_first_not_of(" \t");
+		if (at == std::string::npos || line[at] != '#') {
+			return false;
+		}
+		at = line.find_first_not_of(" \t", at + 1);
+		if (at == std::string::npos || line.compare(at, 7, "include") != 0) {
+			return false;
+		}
+		size_t open = line.find_first_of("\"<", at + 7);
+		if (open == std::string::npos) {
+			return false;
+		}
+		size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+		if (close == std::string::npos) {
+			return false;
+		}
+		name = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	// GLSL #line only takes a source string number, so files are numbered by dependency order
+	// and compile errors read as "<file index>(<line>)"
+	bool appendFile(const std::string& path, int depth, std::string& out, std::vector<std::string>& dependencies, std::set<std::string>& included) {
+		std::string file = normalize(path);
+		if (!included.insert(file).second) {
+			return true; // already pasted into this expansion
+		}
+		if (depth > 32) {
+			std::cout << "ERROR::SHADER::PREPROCESSOR::INCLUDE_TOO_DEEP " << file << std::endl;
+			return false;
+		}
+		const std::string* text = readFile(file);
+		if (!text) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << file << std::endl;
+			return false;
+		}
+		int fileIndex = (int)dependencies.size();
+		dependencies.push_back(file);
+		if (depth > 0) {
+			out += "#line 1 " + std::to_string(fileIndex) + "\n";
+		}
+
+		std::istringstream lines(*text);
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(lines, line)) {
+			lineNumber++;
+			std::string includeName;
+			if (!parseInclude(line, includeName)) {
+				out += line;
+				out += '\n';
+				continue;
+			}
+			if (!appendFile(directoryOf(file) + "/" + includeName, depth + 1, out, dependencies, included)) {
+				std::cout << "  included from " << file << ":" << lineNumber << std::endl;
+				return false;
+			}
+			out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+		return true;
+	}
+
+	// defines have to come after #version, which must be the first thing in the shader
+	static void injectDefines(std::string& code, const ShaderDefines& defines) {
+		if (defines.empty()) {
+			return;
+		}
+		std::string block;
+		for (const std::pair<std::string, std::string>& define : defines.list()) {
+			block += "#define " + define.first + " " + define.second + "\n";
+		}
+		size_t insertAt = 0;
+		size_t version = code.find("#version");
+		if (version != std::string::npos) {
+			size_t lineEnd = code.find('\n', version);
+			insertAt = lineEnd == std::string::npos ? code.size() : lineEnd + 1;
+			if (lineEnd == std::string::npos) {
+				block = "\n" + block;
+			}
+		}
+		// keep the line numbers of the rest of the file as they were
+		std::string lineNumber = std::to_string(std::count(code.begin(), code.begin() + insertAt, '\n') + 1);
+		code.insert(insertAt, block + "#line " + lineNumber + " 0\n");
+	}
+};
+
+#endif
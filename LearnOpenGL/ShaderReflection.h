@@ -0,0 +1,234 @@
+#pragma once
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+// vertex inputs, e.g. aPos/aColor/aTexCoord in vertexShader.glsl
+struct ShaderAttribute {
+	std::string name;
+	int location = -1;
+	GLenum type = 0;
+	int size = 0; // array length, 1 for plain attributes
+};
+
+// default block uniforms that have a location (block members live in ShaderUniformBlock)
+struct ShaderUniform {
+	std::string name;
+	int location = -1;
+	GLenum type = 0;
+	int size = 0;
+};
+
+// sampler uniforms and the texture unit each one reads from
+// an array of samplers reads from `size` consecutive units starting at `unit`
+struct ShaderSampler {
+	std::string name; // without the "[0]" GL reports for arrays
+	int location = -1;
+	GLenum type = 0;
+	int size = 0;
+	int unit = -1;
+};
+
+struct ShaderUniformBlock {
+	std::string name;
+	GLuint index = 0;
+	GLuint binding = 0; // UniformBlockBindings::NO_POINT if the binding points ran out
+	int dataSize = 0; // bytes the program expects the bound buffer range to cover
+};
+
+// everything the linker kept active in a program, read once after linking so nothing
+// has to ask the driver again at draw time
+// samplers are also listed in uniforms, every list is sorted by name
+class ShaderReflection {
+public:
+	std::vector<ShaderAttribute> attributes;
+	std::vector<ShaderUniform> uniforms;
+	std::vector<ShaderSampler> samplers;
+	std::vector<ShaderUniformBlock> blocks;
+
+	// sampler units and block bindings are left for the caller to assign
+	static ShaderReflection of(GLuint program) {
+		ShaderReflection reflection;
+		reflection.reflectAttributes(program);
+		reflection.reflectUniforms(program);
+		reflection.reflectBlocks(program);
+		return reflection;
+	}
+
+	// null when the program has no active input/sampler/block by that name
+	const ShaderAttribute* attribute(const std::string& name) const {
+		return find(attributes, name);
+	}
+	const ShaderSampler* sampler(const std::string& name) const {
+		return find(samplers, name);
+	}
+	const ShaderUniformBlock* block(const std::string& name) const {
+		return find(blocks, name);
+	}
+
+	// check once at load time that a VAO feeds every active attribute of the program
+	// reports a disabled array (the attribute would read a constant) or a float/integer
+	// mismatch between glVertexAttribPointer/glVertexAttribIPointer and the GLSL type
+	// fewer components than the GLSL type is fine, GL fills in (0, 0, 0, 1)
+	bool validateVertexArray(GLuint vao, const std::string& label = std::string()) const {
+		GLint previous = 0;
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+		glBindVertexArray(vao);
+
+		bool valid = true;
+		for (const ShaderAttribute& input : attributes) {
+			if (input.location < 0) {
+				continue; // built-ins like gl_VertexID
+			}
+			int slots = locationsPerElement(input.type) * input.size;
+			for (int slot = 0; slot < slots; ++slot) {
+				GLuint location = (GLuint)(input.location + slot);
+				GLint enabled = 0, integer = 0;
+				glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+				glGetVertexAttribiv(location, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+				if (!enabled) {
+					std::cout << "ERROR::SHADER::VERTEX_LAYOUT::ATTRIBUTE_NOT_ENABLED " << label << " \""
+						<< input.name << "\" at location " << location << std::endl;
+					valid = false;
+				}
+				else if ((integer != 0) != isIntegerType(input.type)) {
+					std::cout << "ERROR::SHADER::VERTEX_LAYOUT::TYPE_MISMATCH " << label << " \"" << input.name
+						<< "\" is " << (isIntegerType(input.type) ? "an integer" : "a float")
+						<< " input but its array was set up with " << (integer ? "glVertexAttribIPointer" : "glVertexAttribPointer") << std::endl;
+					valid = false;
+				}
+			}
+		}
+
+		glBindVertexArray((GLuint)previous);
+		return valid;
+	}
+
+	static bool isSamplerType(GLenum type) {
+		switch (type) {
+		case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER:
+		case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+		case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_RECT:
+		case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+private:
+	template <typename T>
+	static const T* find(const std::vector<T>& list, const std::string& name) {
+		typename std::vector<T>::const_iterator at = std::lower_bound(list.begin(), list.end(), name,
+			[](const T& entry, const std::string& key) { return entry.name < key; });
+		return at != list.end() && at->name == name ? &*at : nullptr;
+	}
+
+	template <typename T>
+	static void sortByName(std::vector<T>& list) {
+		std::sort(list.begin(), list.end(), [](const T& a, const T& b) { return a.name < b.name; });
+	}
+
+	static bool isIntegerType(GLenum type) {
+		switch (type) {
+		case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+		case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// matrix inputs take one location per column
+	static int locationsPerElement(GLenum type) {
+		switch (type) {
+		case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4:
+			return 2;
+		case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4:
+			return 3;
+		case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+			return 4;
+		default:
+			return 1;
+		}
+	}
+
+	void reflectAttributes(GLuint program) {
+		int count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+		std::vector<char> name(maxLength + 1);
+		for (int i = 0; i < count; ++i) {
+			ShaderAttribute input;
+			glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), NULL, &input.size, &input.type, name.data());
+			input.name = name.data();
+			input.location = glGetAttribLocation(program, name.data());
+			attributes.push_back(input);
+		}
+		sortByName(attributes);
+	}
+
+	void reflectUniforms(GLuint program) {
+		int count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> name(maxLength + 1);
+		for (int i = 0; i < count; ++i) {
+			ShaderUniform uniform;
+			glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), NULL, &uniform.size, &uniform.type, name.data());
+			uniform.location = glGetUniformLocation(program, name.data());
+			if (uniform.location < 0) {
+				continue; // members of uniform blocks have no location
+			}
+			uniform.name = name.data();
+			uniforms.push_back(uniform);
+			if (isSamplerType(uniform.type)) {
+				ShaderSampler sampler;
+				sampler.name = uniform.name;
+				size_t bracket = sampler.name.rfind("[0]");
+				if (bracket != std::string::npos && bracket + 3 == sampler.name.size()) {
+					sampler.name.erase(bracket);
+				}
+				sampler.location = uniform.location;
+				sampler.type = uniform.type;
+				sampler.size = uniform.size;
+				samplers.push_back(sampler);
+			}
+		}
+		sortByName(uniforms);
+		sortByName(samplers);
+	}
+
+	void reflectBlocks(GLuint program) {
+		int count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+		std::vector<char> name(maxLength + 1);
+		for (int i = 0; i < count; ++i) {
+			ShaderUniformBlock block;
+			block.index = (GLuint)i;
+			glGetActiveUniformBlockName(program, block.index, (GLsizei)name.size(), NULL, name.data());
+			glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+			block.name = name.data();
+			blocks.push_back(block);
+		}
+		sortByName(blocks);
+	}
+};
+
+#endif
@@ -0,0 +1,376 @@
+#pragma once
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include "./Shader.h"
+#include "./ShaderPreprocessor.h"
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// hot reload for Shaders built from files
+// a background thread notices edits to the .glsl files or anything they #include (inotify
+// on linux, polling the modification times elsewhere) and re-expands the sources through
+// the ShaderPreprocessor
+// given the main window, the thread also compiles and links the new program on a hidden
+// context sharing objects with it, and update() only swaps the finished program in, so the
+// render loop never waits on the compiler
+// without one, update() submits the recompile on the GL thread and checks it from a later
+// update(), with KHR_parallel_shader_compile only once the driver says it's done, without it
+// the check waits for whatever compiling is left
+// either way a program that doesn't compile or link is thrown away and the old one stays
+class ShaderWatcher {
+public:
+	// on the main thread (GLFW creates windows nowhere else), after the main window exists
+	explicit ShaderWatcher(GLFWwindow* sharedWith = nullptr) {
+		if (sharedWith) {
+			// the window hints the main window was made with still apply, so the context matches it
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			compileWindow = glfwCreateWindow(1, 1, "Shader Compiler", NULL, sharedWith);
+			glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+			if (!compileWindow) {
+				std::cout << "ERROR::SHADER::WATCHER::SHARED_CONTEXT_FAILED compiling reloads on the GL thread" << std::endl;
+			}
+		}
+#ifdef __linux__
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd < 0) {
+			std::cout << "ERROR::SHADER::WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+		}
+#endif
+		running = true;
+		thread = std::thread(&ShaderWatcher::run, this);
+	}
+
+	~ShaderWatcher() {
+		running = false;
+		thread.join();
+#ifdef __linux__
+		if (inotifyFd >= 0) {
+			close(inotifyFd);
+		}
+#endif
+		// the GL thread's context is current here, the programs are shared with it
+		for (ReloadRequest& request : requests) {
+			discard(request);
+		}
+		for (GLuint program : discarded) {
+			glDeleteProgram(program);
+		}
+		if (compileWindow) {
+			glfwDestroyWindow(compileWindow);
+		}
+	}
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	// the shader has to outlive the watcher or be unwatched first
+	void watch(Shader& shader) {
+		if (shader.getVertexPath().empty()) {
+			return; // built from ShaderSourceCode, nothing to watch
+		}
+		WatchedShader entry;
+		entry.shader = &shader;
+		entry.vertexPath = shader.getVertexPath();
+		entry.fragmentPath = shader.getFragmentPath();
+		entry.defines = shader.getDefines();
+		entry.files = shader.getDependencies();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const std::string& file : entry.files) {
+			watchDirectory(directoryOf(file));
+		}
+		watched.push_back(entry);
+	}
+
+	// GL thread
+	void unwatch(Shader& shader) {
+		std::lock_guard<std::mutex> lock(mutex);
+		watched.erase(std::remove_if(watched.begin(), watched.end(),
+			[&shader](const WatchedShader& entry) { return entry.shader == &shader; }), watched.end());
+		for (ReloadRequest& request : requests) {
+			if (request.shader == &shader) {
+				discard(request);
+			}
+		}
+		requests.erase(std::remove_if(requests.begin(), requests.end(),
+			[&shader](const ReloadRequest& request) { return request.shader == &shader; }), requests.end());
+		inFlight.erase(std::remove(inFlight.begin(), inFlight.end(), &shader), inFlight.end());
+	}
+
+	// call on the GL thread at a frame boundary (e.g. right after glfwSwapBuffers)
+	void update() {
+		std::vector<ReloadRequest> ready;
+		std::vector<GLuint> unused;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ready.swap(requests);
+			unused.swap(discarded);
+		}
+		for (GLuint program : unused) {
+			glDeleteProgram(program);
+		}
+
+		// builds submitted by an earlier update() first, so none is checked in the frame it started
+		for (size_t i = 0; i < inFlight.size();) {
+			Shader* shader = inFlight[i];
+			if (shader->pollReload()) {
+				std::cout << "reloaded " << shader->getVertexPath() << " + " << shader->getFragmentPath() << std::endl;
+			}
+			if (shader->reloading()) {
+				++i;
+			}
+			else {
+				inFlight.erase(inFlight.begin() + i);
+			}
+		}
+
+		for (ReloadRequest& request : ready) {
+			Shader* shader = request.shader;
+			if (!request.built) {
+				shader->beginReload(request.vertexSource, request.fragmentSource);
+				if (std::find(inFlight.begin(), inFlight.end(), shader) == inFlight.end()) {
+					inFlight.push_back(shader);
+				}
+				continue;
+			}
+			inFlight.erase(std::remove(inFlight.begin(), inFlight.end(), shader), inFlight.end());
+			if (request.program == 0) {
+				std::cout << "ERROR::SHADER::RELOAD_FAILED keeping the previous program for "
+					<< shader->getVertexPath() << " + " << shader->getFragmentPath() << std::endl;
+				continue;
+			}
+			shader->adoptReload(request.program, request.vertexSource, request.fragmentSource);
+			std::cout << "reloaded " << shader->getVertexPath() << " + " << shader->getFragmentPath() << std::endl;
+		}
+	}
+
+private:
+	// copies of what the watcher thread needs, it never touches the Shader itself
+	struct WatchedShader {
+		Shader* shader;
+		std::string vertexPath;
+		std::string fragmentPath;
+		ShaderDefines defines;
+		std::vector<std::string> files; // normalized, see ShaderPreprocessor::normalize()
+	};
+	struct ReloadRequest {
+		Shader* shader;
+		std::shared_ptr<const ExpandedShaderSource> vertexSource;
+		std::shared_ptr<const ExpandedShaderSource> fragmentSource;
+		bool built = false; // compiled on the shared context, program is the result
+		GLuint program = 0; // owned by the request until update() hands it to the shader
+	};
+
+	GLFWwindow* compileWindow = nullptr; // hidden, its context is current on the watcher thread
+	std::mutex mutex; // guards watched, requests, discarded and the directory map
+	std::vector<WatchedShader> watched;
+	std::vector<ReloadRequest> requests;
+	std::vector<GLuint> discarded; // built programs nobody wants anymore, deleted on the GL thread
+	std::vector<Shader*> inFlight; // GL thread only
+	std::atomic<bool> running;
+	std::thread thread;
+#ifdef __linux__
+	int inotifyFd = -1;
+	std::map<int, std::string> directories; // inotify watch descriptor -> directory
+#else
+	std::map<std::string, time_t> modifiedTimes; // watcher thread only
+#endif
+
+	static std::string directoryOf(const std::string& path) {
+		size_t slash = path.rfind('/');
+		return slash == 0 ? "/" : path.substr(0, slash);
+	}
+
+	// caller holds the mutex
+	void watchDirectory(const std::string& directory) {
+#ifdef __linux__
+		if (inotifyFd < 0) {
+			return;
+		}
+		for (const std::pair<const int, std::string>& entry : directories) {
+			if (entry.second == directory) {
+				return;
+			}
+		}
+		// editors either write in place or write a temp file and rename it over ours
+		int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd >= 0) {
+			directories[wd] = directory;
+		}
+#else
+		(void)directory;
+#endif
+	}
+
+	// caller holds the mutex
+	void discard(ReloadRequest& request) {
+		if (request.program != 0) {
+			discarded.push_back(request.program);
+			request.program = 0;
+		}
+	}
+
+	void run() {
+		if (compileWindow) {
+			glfwMakeContextCurrent(compileWindow);
+		}
+		while (running) {
+			std::vector<std::string> changed = waitForChanges();
+			if (!changed.empty()) {
+				queueReloads(changed);
+			}
+		}
+		if (compileWindow) {
+			glfwMakeContextCurrent(NULL); // a context current on another thread can't be destroyed
+		}
+	}
+
+#ifdef __linux__
+	std::vector<std::string> waitForChanges() {
+		std::vector<std::string> changed;
+		if (inotifyFd < 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			return changed;
+		}
+		pollfd descriptor = { inotifyFd, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0) {
+			return changed;
+		}
+		// saves tend to arrive as a burst of events, give the editor a moment to finish
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+			for (char* at = buffer; at < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)at;
+				if (event->len > 0) {
+					std::lock_guard<std::mutex> lock(mutex);
+					std::map<int, std::string>::const_iterator directory = directories.find(event->wd);
+					if (directory != directories.end()) {
+						changed.push_back(ShaderPreprocessor::normalize(directory->second + "/" + event->name));
+					}
+				}
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+		return changed;
+	}
+#else
+	std::vector<std::string> waitForChanges() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		std::vector<std::string> files;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const WatchedShader& entry : watched) {
+				files.insert(files.end(), entry.files.begin(), entry.files.end());
+			}
+		}
+		std::vector<std::string> changed;
+		for (const std::string& file : files) {
+			struct stat info;
+			if (stat(file.c_str(), &info) != 0) {
+				continue;
+			}
+			std::map<std::string, time_t>::iterator known = modifiedTimes.find(file);
+			if (known == modifiedTimes.end()) {
+				modifiedTimes[file] = info.st_mtime; // first sighting isn't an edit
+			}
+			else if (known->second != info.st_mtime) {
+				known->second = info.st_mtime;
+				changed.push_back(file);
+			}
+		}
+		return changed;
+	}
+#endif
+
+	// runs on the watcher thread, the file reads (and with a shared context the compiles) stay
+	// off the GL thread
+	void queueReloads(const std::vector<std::string>& changed) {
+		std::vector<WatchedShader> affected;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const WatchedShader& entry : watched) {
+				for (const std::string& file : entry.files) {
+					if (std::find(changed.begin(), changed.end(), file) != changed.end()) {
+						affected.push_back(entry);
+						break;
+					}
+				}
+			}
+		}
+
+		ShaderPreprocessor& preprocessor = ShaderPreprocessor::instance();
+		for (const std::string& file : changed) {
+			preprocessor.invalidate(file);
+		}
+
+		for (const WatchedShader& entry : affected) {
+			ReloadRequest request;
+			request.shader = entry.shader;
+			request.vertexSource = preprocessor.expand(entry.vertexPath, entry.defines);
+			request.fragmentSource = preprocessor.expand(entry.fragmentPath, entry.defines);
+			if (!request.vertexSource || !request.fragmentSource) {
+				continue; // caught a file mid-save, the next event will bring it back
+			}
+			if (compileWindow) {
+				request.program = Shader::buildShared(request.vertexSource->code, request.fragmentSource->code);
+				request.built = true;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			// the shader might have been unwatched while we were reading
+			bool stillWatched = false;
+			for (const WatchedShader& current : watched) {
+				stillWatched = stillWatched || current.shader == request.shader;
+			}
+			if (!stillWatched) {
+				discard(request);
+				continue;
+			}
+			// an edit may have added #includes, watch those too
+			for (WatchedShader& current : watched) {
+				if (current.shader != request.shader) {
+					continue;
+				}
+				current.files = request.vertexSource->dependencies;
+				for (const std::string& file : request.fragmentSource->dependencies) {
+					if (std::find(current.files.begin(), current.files.end(), file) == current.files.end()) {
+						current.files.push_back(file);
+					}
+				}
+				for (const std::string& file : current.files) {
+					watchDirectory(directoryOf(file));
+				}
+			}
+			// only the newest sources matter
+			for (ReloadRequest& queued : requests) {
+				if (queued.shader == request.shader) {
+					discard(queued);
+				}
+			}
+			requests.erase(std::remove_if(requests.begin(), requests.end(),
+				[&request](const ReloadRequest& queued) { return queued.shader == request.shader; }), requests.end());
+			requests.push_back(request);
+		}
+	}
+};
+
+#endif
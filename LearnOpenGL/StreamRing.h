@@ -0,0 +1,211 @@
+#pragma once
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// one buffer for everything that changes every frame (uniform blocks, instance data, streamed
+// vertices), split into FRAMES regions used round robin: a frame sub-allocates from its region,
+// writes straight into mapped memory and fences the region when it ends, and the region is only
+// written again once that fence passed, FRAMES - 1 frames later, so the GPU can still be reading
+// the last two frames without the CPU ever waiting on it (unless it runs that far ahead)
+// nothing is copied by glBufferSubData and nothing is orphaned, the driver never has to find
+// a fresh buffer behind our back
+// with ARB_buffer_storage the buffer stays persistently and coherently mapped, otherwise the
+// writes go into a CPU copy and commit() maps just that range (unsynchronized, the fence already
+// made sure it's free) and copies it over
+class StreamRing {
+public:
+	static const unsigned int FRAMES = 3;
+
+	// a piece of the current frame's region, write `size` bytes to `memory`, then commit() it
+	struct Allocation {
+		unsigned char* memory = nullptr;
+		GLintptr offset = 0; // into the ring's buffer
+		size_t size = 0;
+
+		explicit operator bool() const {
+			return memory != nullptr;
+		}
+	};
+
+	struct Stats {
+		size_t bytes = 0;        // streamed
+		double fenceWaitMs = 0.0; // the CPU ran FRAMES frames ahead of the GPU and had to wait
+		unsigned int failed = 0;  // allocations that didn't fit in the frame's region
+	};
+
+	// GL thread, frameBytes is what one frame can stream
+	explicit StreamRing(size_t frameBytes = 4 * 1024 * 1024) : regionSize(frameBytes), buffer(GLBuffer::create()) {
+		persistentlyMapped = glExt().bufferStorage;
+		const GLsizeiptr size = (GLsizeiptr)(regionSize * FRAMES);
+		// bound to a target nobody draws from, so setting it up disturbs nothing
+		glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+		if (persistentlyMapped) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glExt().BufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+			memory = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+			if (!memory) {
+				std::cout << "ERROR::STREAM_RING::MAP_FAILED falling back to copies" << std::endl;
+				// immutable storage can't be respecified, start over with a mutable buffer
+				buffer = GLBuffer::create();
+				glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+				persistentlyMapped = false;
+			}
+		}
+		if (!persistentlyMapped) {
+			glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+			shadow.resize((size_t)size);
+			memory = shadow.data();
+		}
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniformOffsetAlignment = (size_t)alignment;
+	}
+
+	~StreamRing() {
+		for (GLsync& fence : fences) {
+			if (fence) {
+				glDeleteSync(fence);
+			}
+		}
+		if (persistentlyMapped && memory) {
+			glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+	}
+
+	StreamRing(const StreamRing&) = delete;
+	StreamRing& operator=(const StreamRing&) = delete;
+
+	GLuint id() const {
+		return buffer.id();
+	}
+	bool persistent() const {
+		return persistentlyMapped;
+	}
+	size_t frameBytes() const {
+		return regionSize;
+	}
+	// what allocations bound with glBindBufferRange(GL_UNIFORM_BUFFER, ...) have to be aligned to
+	size_t uniformAlignment() const {
+		return uniformOffsetAlignment;
+	}
+
+	// GL thread, before the frame's first allocate()
+	// waits only if the GPU is still reading what this region held FRAMES frames ago
+	void beginFrame() {
+		region = frameIndex % FRAMES;
+		head = 0;
+		frame = Stats();
+		reportedFull = false;
+		GLsync& fence = fences[region];
+		if (!fence) {
+			return;
+		}
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			// flushing makes sure the fence gets to the GPU at all, then wait in 1s steps
+			do {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+			} while (status == GL_TIMEOUT_EXPIRED);
+			frame.fenceWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (status == GL_WAIT_FAILED) {
+				std::cout << "ERROR::STREAM_RING::FENCE_WAIT_FAILED" << std::endl;
+			}
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	// `bytes` at an offset that's a multiple of `alignment` (any value, e.g. sizeof(InstanceData)
+	// to address the data by instance, or GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for glBindBufferRange)
+	// an empty Allocation (and reported once per frame) if the frame's region is full
+	Allocation allocate(size_t bytes, size_t alignment = 16) {
+		Allocation allocation;
+		size_t start = region * regionSize;
+		size_t offset = (start + head + alignment - 1) / alignment * alignment;
+		if (offset + bytes > start + regionSize) {
+			frame.failed++;
+			if (!reportedFull) {
+				std::cout << "ERROR::STREAM_RING::FRAME_FULL " << bytes << " more bytes don't fit in " << regionSize << std::endl;
+				reportedFull = true;
+			}
+			return allocation;
+		}
+		head = offset + bytes - start;
+		allocation.memory = memory + offset;
+		allocation.offset = (GLintptr)offset;
+		allocation.size = bytes;
+		frame.bytes += bytes;
+		return allocation;
+	}
+
+	// after writing an allocation and before drawing from it, free when persistently mapped
+	void commit(const Allocation& allocation) {
+		if (persistentlyMapped || !allocation) {
+			return;
+		}
+		glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+		void* target = glMapBufferRange(GL_COPY_WRITE_BUFFER, allocation.offset, (GLsizeiptr)allocation.size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!target) {
+			std::cout << "ERROR::STREAM_RING::MAP_FAILED range at " << allocation.offset << std::endl;
+			return;
+		}
+		std::memcpy(target, allocation.memory, allocation.size);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	// GL thread, after the frame's last draw reading from the ring
+	void endFrame() {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frameIndex++;
+		lastFrame = frame;
+		total.bytes += frame.bytes;
+		total.fenceWaitMs += frame.fenceWaitMs;
+		total.failed += frame.failed;
+	}
+
+	// the frame endFrame() last closed
+	const Stats& frameStats() const {
+		return lastFrame;
+	}
+	const Stats& totalStats() const {
+		return total;
+	}
+
+	void printStats() const {
+		std::cout << "Stream ring (" << (persistentlyMapped ? "persistent" : "mapped copies") << "): " << lastFrame.bytes << " bytes streamed, "
+			<< lastFrame.fenceWaitMs << " ms fence wait last frame, " << total.bytes << " bytes and " << total.fenceWaitMs << " ms over "
+			<< frameIndex << " frames" << std::endl;
+	}
+
+private:
+	size_t regionSize;
+	size_t uniformOffsetAlignment = 256;
+	GLBuffer buffer;
+	bool persistentlyMapped = false;
+	unsigned char* memory = nullptr;   // the mapping, or shadow
+	std::vector<unsigned char> shadow; // without persistent mapping
+	GLsync fences[FRAMES] = {};
+	unsigned long long frameIndex = 0;
+	size_t region = 0;
+	size_t head = 0; // bytes used in the current region
+	bool reportedFull = false;
+	Stats frame;
+	Stats lastFrame;
+	Stats total;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef STREAMED_TEXTURE_H
+#define STREAMED_TEXTURE_H
+
+#include <glad/glad.h>
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./Texture.h"
+#include "./TextureLoader.h"
+
+#include <string>
+#include <memory>
+
+// a texture that can be drawn with straight away
+// id() is the loader's 1x1 placeholder until the image has been decoded and uploaded
+// by TextureLoader::pump(), then the real texture, so bind code never changes and the
+// render loop can start before a single image is decoded
+// a failed load keeps the placeholder (the loader reports the error)
+// the loader has to outlive its StreamedTextures, it owns the placeholder
+class StreamedTexture {
+public:
+	StreamedTexture() {}
+
+	StreamedTexture(TextureLoader& loader, const std::string& path, const TextureParams& params)
+		: state(std::make_shared<State>()) {
+		state->placeholder = loader.placeholder();
+		// a weak_ptr so dropping the handle mid-load just throws the upload away
+		std::weak_ptr<State> target = state;
+		loader.load(path, params, [target](GLTexture texture, const TextureImage& image) {
+			std::shared_ptr<State> alive = target.lock();
+			if (alive) {
+				alive->texture = std::move(texture);
+				alive->width = image.width;
+				alive->height = image.height;
+			}
+		});
+	}
+
+	// what to bind this frame
+	GLuint id() const {
+		if (!state) {
+			return 0;
+		}
+		return state->texture ? state->texture.id() : state->placeholder;
+	}
+
+	// true once the real image replaced the placeholder
+	bool streamedIn() const {
+		return state && state->texture;
+	}
+
+	// size of the real image, 0 until it streamed in
+	int width() const {
+		return state ? state->width : 0;
+	}
+	int height() const {
+		return state ? state->height : 0;
+	}
+
+	void bind(GLuint unit) const {
+		glState().bindTexture(unit, GL_TEXTURE_2D, id());
+	}
+
+private:
+	// shared with the loader's callback, which fills it in on the GL thread
+	struct State {
+		GLuint placeholder = 0;
+		GLTexture texture;
+		int width = 0;
+		int height = 0;
+	};
+	std::shared_ptr<State> state;
+};
+
+#endif
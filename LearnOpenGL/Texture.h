@@ -0,0 +1,331 @@
+#pragma once
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./MipGenerator.h"
+#include "./BlockCompressor.h"
+#include "stb_image.h"
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+// how a 2D texture is sampled and whether it gets mipmaps
+struct TextureParams {
+	GLint wrapS = GL_REPEAT;
+	GLint wrapT = GL_REPEAT;
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	bool mipmaps = true;
+	bool cpuMipmaps = false;    // build the chain with MipGenerator while decoding instead of glGenerateMipmap
+	bool compress = false;      // BC1 (RGB) / BC3 (RGBA) while decoding, needs S3TC support, implies cpuMipmaps
+	bool flipVertically = true; // image rows run top down, GL's bottom up
+	bool srgb = false;          // color data stored gamma encoded, sampled as linear
+};
+
+// pixels decoded by stb_image, freed with stbi_image_free
+struct StbiPixelsDeleter {
+	void operator()(unsigned char* pixels) const {
+		stbi_image_free(pixels);
+	}
+};
+
+// a decoded image waiting to be uploaded, move-only since it owns the pixels
+struct TextureImage {
+	std::string path;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::unique_ptr<unsigned char, StbiPixelsDeleter> pixels; // null once copied into staging memory
+	std::vector<MipLevel> mips; // levels 1.. when built on the CPU, empty to let the GL generate them
+	CompressedImage compressed; // replaces pixels and mips once compress() ran
+	std::string error; // stbi_failure_reason() is per thread, so it's copied here
+	unsigned long long contentHash = 0; // of the decoded base level, see hashTextureContent()
+	// what the uploaded texture looks like, filled in by TextureLoader
+	GLenum internalFormat = 0;
+	int levels = 0;
+	size_t textureBytes = 0; // video memory it takes, see textureStorageBytes()
+
+	explicit operator bool() const {
+		return pixels != nullptr;
+	}
+
+	// base level only
+	size_t byteSize() const {
+		return (size_t)width * height * channels;
+	}
+	// base level and every CPU built mip level
+	size_t chainByteSize() const {
+		size_t bytes = byteSize();
+		for (const MipLevel& level : mips) {
+			bytes += level.pixels.size();
+		}
+		return bytes;
+	}
+
+	// fills `mips` from the base level, meant for the decoding thread
+	void generateMips(bool srgb) {
+		if (pixels) {
+			mips = MipGenerator::generate(pixels.get(), width, height, channels, srgb);
+		}
+	}
+
+	// block compresses the base level and `mips` into `compressed` and frees the raw pixels
+	// RGB and RGBA only, anything else stays uncompressed
+	void compress(unsigned int threads) {
+		if (!pixels || channels < 3) {
+			return;
+		}
+		compressed = BlockCompressor::compress(pixels.get(), width, height, channels, mips, threads);
+		pixels.reset();
+		mips.clear();
+	}
+
+	// stbi_load on the calling thread, safe to call from several threads at once
+	static TextureImage decode(const std::string& path, bool flipVertically) {
+		TextureImage image;
+		image.path = path;
+		stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+		image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0));
+		if (!image.pixels) {
+			image.error = stbi_failure_reason() ? stbi_failure_reason() : "unknown error";
+		}
+		return image;
+	}
+};
+
+// GL formats for 1-4 channel 8 bit images
+inline GLenum textureFormatFor(int channels) {
+	switch (channels) {
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+// sized internal formats for 1-4 channel 8 bit images
+// sRGB only exists for RGB/RGBA, one and two channel images are never color anyway
+inline GLenum textureInternalFormatFor(int channels, bool srgb) {
+	switch (channels) {
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+	default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+// levels in a full mip chain down to 1x1: floor(log2(max(width, height))) + 1
+inline int mipLevelCount(int width, int height) {
+	int largest = width > height ? width : height;
+	int levels = 1;
+	while (largest > 1) {
+		largest >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+// video memory a texture of `levels` mip levels takes, an estimate of what the driver allocates
+inline size_t textureStorageBytes(GLenum internalFormat, int width, int height, int levels) {
+	size_t bytes = 0;
+	for (int level = 0; level < levels; ++level) {
+		size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+		switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+			bytes += blocks * 8;
+			break;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+			bytes += blocks * 16;
+			break;
+		case GL_R8: bytes += (size_t)width * height; break;
+		case GL_RG8: bytes += (size_t)width * height * 2; break;
+		default: bytes += (size_t)width * height * 4; break; // drivers pad RGB8 texels to 4 bytes too
+		}
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return bytes;
+}
+
+// 8 bit pixels of any stb_image channel count as RGBA (grey, grey + alpha, RGB, RGBA)
+// for textures that mix images of different channel counts in one format
+inline void convertToRGBA(const unsigned char* pixels, int width, int height, int channels, unsigned char* rgba) {
+	size_t count = (size_t)width * height;
+	for (size_t i = 0; i < count; ++i) {
+		const unsigned char* source = pixels + i * channels;
+		unsigned char* target = rgba + i * 4;
+		target[0] = source[0];
+		target[1] = channels >= 3 ? source[1] : source[0];
+		target[2] = channels >= 3 ? source[2] : source[0];
+		target[3] = channels == 4 ? source[3] : channels == 2 ? source[1] : 255;
+	}
+}
+
+// the S3TC formats BlockCompressor output is uploaded as
+inline bool isCompressedTextureFormat(GLenum internalFormat) {
+	return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+		|| internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT || internalFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+}
+
+// 64 bit hash of pixel data to recognize identical images (not meant to resist crafted collisions)
+// eight bytes a step, about as fast as memcpy, so workers can afford it on every image
+inline unsigned long long hashTextureContent(const unsigned char* data, size_t size, unsigned long long seed = 0) {
+	const unsigned long long MULTIPLIER = 0x9E3779B97F4A7C15ull;
+	unsigned long long hash = seed ^ (size * MULTIPLIER);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		unsigned long long word;
+		std::memcpy(&word, data + i, 8);
+		hash ^= word * MULTIPLIER;
+		hash = ((hash << 31) | (hash >> 33)) * 0xBF58476D1CE4E5B9ull;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	}
+	hash ^= hash >> 30;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 27;
+	return hash;
+}
+
+// allocates every level of the texture bound to GL_TEXTURE_2D in one go
+// immutable through ARB_texture_storage where we have it (the driver never has to
+// reallocate or re-check completeness), otherwise each level is specified up front and
+// MAX_LEVEL pins the chain to the same number of levels
+inline void allocateTextureStorage2D(GLsizei levels, GLenum internalFormat, GLenum format, GLsizei width, GLsizei height) {
+	if (glExt().textureStorage) {
+		glExt().TexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+		return;
+	}
+	for (GLsizei level = 0; level < levels; ++level) {
+		glTexImage2D(GL_TEXTURE_2D, level, (GLint)internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// creates a texture from 8 bit pixels, must run on the GL thread
+// storage for the whole mip chain is allocated first, then `levels[0..levelCount)` are filled in
+// and if that's just the base level the rest of the chain is generated by the GL
+// with a buffer bound to GL_PIXEL_UNPACK_BUFFER the level pointers are offsets into that buffer
+// leaves the texture bound to the active unit's GL_TEXTURE_2D the way it found it
+inline GLTexture uploadTexture2D(int width, int height, int channels, const void* const* levelPixels, int levelCount, const TextureParams& params) {
+	GLTexture texture = GLTexture::create();
+	GLint previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, texture.id());
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+
+	GLenum format = textureFormatFor(channels);
+	int levels = params.mipmaps ? mipLevelCount(width, height) : 1;
+	allocateTextureStorage2D(levels, textureInternalFormatFor(channels, params.srgb), format, width, height);
+
+	// rows of 1 and 3 channel images aren't always a multiple of 4 bytes
+	GLint alignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	int levelWidth = width, levelHeight = height;
+	for (int level = 0; level < levelCount && level < levels; ++level) {
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth, levelHeight, format, GL_UNSIGNED_BYTE, levelPixels[level]);
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	if (levels > 1 && levelCount < levels) {
+		glGenerateMipmap(GL_TEXTURE_2D); // fills the levels we already have, nothing is reallocated
+	}
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+	return texture;
+}
+
+// formats BlockCompressor output uploads as
+inline GLenum compressedFormatFor(BlockFormat format, bool srgb) {
+	if (format == BlockFormat::BC1) {
+		return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+// whether the current context can sample what TextureParams asks BlockCompressor for
+inline bool canUploadCompressed(const TextureParams& params) {
+	return params.srgb ? glExt().textureCompressionS3TCsRGB : glExt().textureCompressionS3TC;
+}
+
+// creates a texture from block compressed levels, must run on the GL thread
+// the driver copies the blocks as they are, there's nothing to convert or generate
+// `levelData` may point anywhere the GL can read, a mapped file included
+inline GLTexture uploadCompressedTexture2D(GLenum internalFormat, int width, int height, const void* const* levelData, const GLsizei* levelBytes, int levelCount, const TextureParams& params) {
+	GLTexture texture = GLTexture::create();
+	GLint previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, texture.id());
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+
+	GLsizei levels = (GLsizei)levelCount;
+	if (glExt().textureStorage) {
+		glExt().TexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+		for (GLsizei level = 0; level < levels; ++level) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, internalFormat, levelBytes[level], levelData[level]);
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+	else {
+		for (GLsizei level = 0; level < levels; ++level) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, levelBytes[level], levelData[level]);
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+	return texture;
+}
+
+// straight from BlockCompressor output
+inline GLTexture uploadCompressedTexture2D(const CompressedImage& image, const TextureParams& params) {
+	std::vector<const void*> levels;
+	std::vector<GLsizei> levelBytes;
+	for (const CompressedLevel& level : image.levels) {
+		levels.push_back(level.blocks.data());
+		levelBytes.push_back((GLsizei)level.blocks.size());
+	}
+	return uploadCompressedTexture2D(compressedFormatFor(image.format, params.srgb), image.levels[0].width, image.levels[0].height,
+		levels.data(), levelBytes.data(), (int)levels.size(), params);
+}
+
+// base level only
+inline GLTexture uploadTexture2D(int width, int height, int channels, const void* pixels, const TextureParams& params) {
+	return uploadTexture2D(width, height, channels, &pixels, 1, params);
+}
+
+// straight from a decoded image in client memory, with its CPU built mips if it has them
+inline GLTexture uploadTexture2D(const TextureImage& image, const TextureParams& params) {
+	std::vector<const void*> levels(1, image.pixels.get());
+	for (const MipLevel& level : image.mips) {
+		levels.push_back(level.pixels.data());
+	}
+	return uploadTexture2D(image.width, image.height, image.channels, levels.data(), (int)levels.size(), params);
+}
+
+#endif
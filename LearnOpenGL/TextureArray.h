@@ -0,0 +1,122 @@
+#pragma once
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./Texture.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+// a GL_TEXTURE_2D_ARRAY of same sized RGBA images, see TextureArrayBuilder
+// sampled with a sampler2DArray and vec3(uv, layer)
+struct TextureArray {
+	GLTexture texture;
+	int width = 0;
+	int height = 0;
+	int layers = 0;
+	std::map<std::string, int> layerOf;
+
+	// -1 if there's no image of that name in the array
+	int layer(const std::string& name) const {
+		std::map<std::string, int>::const_iterator found = layerOf.find(name);
+		return found != layerOf.end() ? found->second : -1;
+	}
+};
+
+// collects images of one size into the layers of an array texture
+// unlike an atlas nothing needs packing or padding, every layer wraps and mipmaps on its own
+// and keeps the full 0..1 coordinate range, but every image has to be the same size
+class TextureArrayBuilder {
+public:
+	// the pixels are copied (as RGBA), the first image decides the size of every layer
+	// false (and reported) if this one doesn't match
+	bool add(const std::string& name, const unsigned char* pixels, int width, int height, int channels) {
+		if (!layers.empty() && (width != layerWidth || height != layerHeight)) {
+			std::cout << "ERROR::TEXTURE::ARRAY::SIZE_MISMATCH " << name << " is " << width << "x" << height
+				<< ", the layers are " << layerWidth << "x" << layerHeight << std::endl;
+			return false;
+		}
+		layerWidth = width;
+		layerHeight = height;
+		Layer layer;
+		layer.name = name;
+		layer.rgba.resize((size_t)width * height * 4);
+		convertToRGBA(pixels, width, height, channels, layer.rgba.data());
+		layers.push_back(std::move(layer));
+		return true;
+	}
+	bool add(const std::string& name, const TextureImage& image) {
+		return add(name, image.pixels.get(), image.width, image.height, image.channels);
+	}
+
+	size_t layerCount() const {
+		return layers.size();
+	}
+
+	// GL thread, uploads every layer added so far
+	// leaves the active unit's GL_TEXTURE_2D_ARRAY binding the way it found it
+	TextureArray build(const TextureParams& params) {
+		TextureArray array;
+		GLint maxLayers = 256;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		if (layers.empty() || (GLint)layers.size() > maxLayers) {
+			std::cout << "ERROR::TEXTURE::ARRAY::LAYER_COUNT " << layers.size() << " layers, the driver allows 1 to " << maxLayers << std::endl;
+			return array;
+		}
+		array.width = layerWidth;
+		array.height = layerHeight;
+		array.layers = (int)layers.size();
+		array.texture = GLTexture::create();
+
+		GLint previous = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previous);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture.id());
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, params.wrapS);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, params.wrapT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, params.magFilter);
+
+		// same idea as allocateTextureStorage2D()
+		GLenum internalFormat = textureInternalFormatFor(4, params.srgb);
+		GLsizei levels = params.mipmaps ? mipLevelCount(layerWidth, layerHeight) : 1;
+		if (glExt().textureStorage) {
+			glExt().TexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, layerWidth, layerHeight, array.layers);
+		}
+		else {
+			for (GLsizei level = 0, width = layerWidth, height = layerHeight; level < levels; ++level) {
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, (GLint)internalFormat, width, height, array.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+				width = width > 1 ? width / 2 : 1;
+				height = height > 1 ? height / 2 : 1;
+			}
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		}
+
+		for (size_t i = 0; i < layers.size(); ++i) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i, layerWidth, layerHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, layers[i].rgba.data());
+			array.layerOf[layers[i].name] = (int)i;
+		}
+		if (levels > 1) {
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY); // per layer, nothing bleeds between them
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)previous);
+		return array;
+	}
+
+private:
+	struct Layer {
+		std::string name;
+		std::vector<unsigned char> rgba;
+	};
+
+	int layerWidth = 0;
+	int layerHeight = 0;
+	std::vector<Layer> layers;
+};
+
+#endif
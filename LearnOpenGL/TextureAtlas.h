@@ -0,0 +1,312 @@
+#pragma once
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+#include "./GLObjects.h"
+#include "./Texture.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+struct AtlasRect {
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
+// packs rectangles into a fixed size area, bottom-left skyline style: the top edge of what's been
+// placed so far is kept as a list of horizontal segments and every rectangle goes where its top
+// ends up lowest (ties go to the narrower segment, which wastes less)
+// much tighter than shelf packing for mixed sizes and still only O(segments) per insert
+class SkylinePacker {
+public:
+	SkylinePacker(int width, int height) : areaWidth(width), areaHeight(height) {
+		skyline.push_back(Segment{ 0, 0, width });
+	}
+
+	// false if the rectangle doesn't fit anywhere
+	bool insert(int width, int height, AtlasRect& placed) {
+		int bestTop = INT_MAX, bestSegmentWidth = INT_MAX;
+		size_t bestIndex = 0;
+		int bestY = 0;
+		for (size_t i = 0; i < skyline.size(); ++i) {
+			int y = fit(i, width, height);
+			if (y < 0) {
+				continue;
+			}
+			if (y + height < bestTop || (y + height == bestTop && skyline[i].width < bestSegmentWidth)) {
+				bestTop = y + height;
+				bestSegmentWidth = skyline[i].width;
+				bestIndex = i;
+				bestY = y;
+			}
+		}
+		if (bestTop == INT_MAX) {
+			return false;
+		}
+		placed.x = skyline[bestIndex].x;
+		placed.y = bestY;
+		placed.width = width;
+		placed.height = height;
+		raise(bestIndex, placed);
+		usedArea += (size_t)width * height;
+		return true;
+	}
+
+	int width() const {
+		return areaWidth;
+	}
+	int height() const {
+		return areaHeight;
+	}
+	// share of the area covered by rectangles
+	double occupancy() const {
+		return (double)usedArea / ((double)areaWidth * areaHeight);
+	}
+
+private:
+	struct Segment {
+		int x;
+		int y; // top of everything placed below this segment
+		int width;
+	};
+
+	int areaWidth;
+	int areaHeight;
+	std::vector<Segment> skyline; // left to right, covers the whole width
+	size_t usedArea = 0;
+
+	// y a rectangle starting at segment `index` would sit at, -1 if it pokes out of the area
+	int fit(size_t index, int width, int height) const {
+		if (skyline[index].x + width > areaWidth) {
+			return -1;
+		}
+		int y = 0;
+		int remaining = width;
+		for (size_t i = index; remaining > 0; ++i) {
+			y = std::max(y, skyline[i].y);
+			if (y + height > areaHeight) {
+				return -1;
+			}
+			remaining -= skyline[i].width;
+		}
+		return y;
+	}
+
+	// the rectangle's top edge becomes a segment, whatever it covers is cut away
+	void raise(size_t index, const AtlasRect& placed) {
+		skyline.insert(skyline.begin() + index, Segment{ placed.x, placed.y + placed.height, placed.width });
+		for (size_t i = index + 1; i < skyline.size();) {
+			int covered = skyline[i - 1].x + skyline[i - 1].width - skyline[i].x;
+			if (covered <= 0) {
+				break;
+			}
+			skyline[i].x += covered;
+			skyline[i].width -= covered;
+			if (skyline[i].width > 0) {
+				break;
+			}
+			skyline.erase(skyline.begin() + i);
+		}
+		// neighbours at the same height are one segment
+		for (size_t i = 0; i + 1 < skyline.size();) {
+			if (skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else {
+				++i;
+			}
+		}
+	}
+};
+
+// where an image ended up in an atlas
+struct AtlasRegion {
+	AtlasRect rect; // in texels, without the padding
+	float u0 = 0.0f, v0 = 0.0f; // texture coordinates of the image's corners
+	float u1 = 0.0f, v1 = 0.0f;
+};
+
+// one RGBA texture holding many images, see TextureAtlasBuilder
+struct TextureAtlas {
+	struct Stats {
+		unsigned int images = 0;
+		unsigned int rejected = 0; // too big for the largest atlas allowed, left out
+		size_t imagePixels = 0;    // what the images cover, padding not included
+		size_t atlasPixels = 0;
+		// share of the atlas that's image, the rest is padding and gaps
+		double efficiency() const {
+			return atlasPixels ? (double)imagePixels / atlasPixels : 0.0;
+		}
+	};
+
+	GLTexture texture;
+	int width = 0;
+	int height = 0;
+	std::map<std::string, AtlasRegion> regions;
+	Stats stats;
+
+	// null if there's no image of that name in the atlas
+	const AtlasRegion* find(const std::string& name) const {
+		std::map<std::string, AtlasRegion>::const_iterator found = regions.find(name);
+		return found != regions.end() ? &found->second : nullptr;
+	}
+};
+
+// collects images and packs them into one texture, so everything drawn with them can share a
+// single binding (and one draw call if their vertices share a buffer)
+// each image gets `padding` texels of its own edge pixels around it so filtering never
+// reaches into its neighbours, and mip levels stop where the padding would shrink below a texel
+class TextureAtlasBuilder {
+public:
+	explicit TextureAtlasBuilder(int padding = 2) : padding(padding) {}
+
+	// the pixels are copied (as RGBA), any channel count stb_image produces works
+	void add(const std::string& name, const unsigned char* pixels, int width, int height, int channels) {
+		Image image;
+		image.name = name;
+		image.width = width;
+		image.height = height;
+		image.rgba.resize((size_t)width * height * 4);
+		convertToRGBA(pixels, width, height, channels, image.rgba.data());
+		images.push_back(std::move(image));
+	}
+	void add(const std::string& name, const TextureImage& image) {
+		add(name, image.pixels.get(), image.width, image.height, image.channels);
+	}
+
+	size_t imageCount() const {
+		return images.size();
+	}
+
+	// GL thread, packs everything added so far into the smallest power of two atlas (up to
+	// maxSize on a side) it fits in and uploads it, images that don't fit are reported and left out
+	// wrapping in params is ignored, repeating across an atlas would show the neighbours
+	TextureAtlas build(const TextureParams& params, int maxSize = 4096) {
+		TextureAtlas atlas;
+		// tallest first, the usual order for skylines
+		std::vector<size_t> order(images.size());
+		size_t area = 0;
+		int widest = 1, tallest = 1;
+		for (size_t i = 0; i < images.size(); ++i) {
+			order[i] = i;
+			area += (size_t)(images[i].width + 2 * padding) * (images[i].height + 2 * padding);
+			widest = std::max(widest, images[i].width + 2 * padding);
+			tallest = std::max(tallest, images[i].height + 2 * padding);
+		}
+		std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+			return images[a].height != images[b].height ? images[a].height > images[b].height : images[a].width > images[b].width;
+		});
+
+		// start where the area could just fit and grow until everything does
+		int width = 1, height = 1;
+		while (width < widest || (size_t)width * width < area) {
+			width *= 2;
+		}
+		while (height < tallest || (size_t)width * height < area) {
+			height *= 2;
+		}
+		width = std::min(width, maxSize);
+		height = std::min(height, maxSize);
+		std::vector<AtlasRect> placed(images.size());
+		std::vector<bool> fits(images.size());
+		for (;;) {
+			SkylinePacker packer(width, height);
+			bool all = true;
+			for (size_t i : order) {
+				fits[i] = packer.insert(images[i].width + 2 * padding, images[i].height + 2 * padding, placed[i]);
+				all = all && fits[i];
+			}
+			if (all || (width >= maxSize && height >= maxSize)) {
+				break;
+			}
+			// keep it square-ish
+			if (height < width) {
+				height *= 2;
+			}
+			else {
+				width *= 2;
+			}
+			width = std::min(width, maxSize);
+			height = std::min(height, maxSize);
+		}
+
+		atlas.width = width;
+		atlas.height = height;
+		atlas.stats.atlasPixels = (size_t)width * height;
+		std::vector<unsigned char> pixels((size_t)width * height * 4, 0);
+		for (size_t i = 0; i < images.size(); ++i) {
+			const Image& image = images[i];
+			if (!fits[i]) {
+				std::cout << "ERROR::TEXTURE::ATLAS::DOES_NOT_FIT " << image.name << " (" << image.width << "x" << image.height << ")" << std::endl;
+				atlas.stats.rejected++;
+				continue;
+			}
+			blit(image, placed[i].x, placed[i].y, width, pixels.data());
+			AtlasRegion region;
+			region.rect.x = placed[i].x + padding;
+			region.rect.y = placed[i].y + padding;
+			region.rect.width = image.width;
+			region.rect.height = image.height;
+			region.u0 = (float)region.rect.x / width;
+			region.v0 = (float)region.rect.y / height;
+			region.u1 = (float)(region.rect.x + image.width) / width;
+			region.v1 = (float)(region.rect.y + image.height) / height;
+			atlas.regions[image.name] = region;
+			atlas.stats.images++;
+			atlas.stats.imagePixels += (size_t)image.width * image.height;
+		}
+
+		TextureParams atlasParams = params;
+		atlasParams.wrapS = GL_CLAMP_TO_EDGE;
+		atlasParams.wrapT = GL_CLAMP_TO_EDGE;
+		atlas.texture = uploadTexture2D(width, height, 4, pixels.data(), atlasParams);
+		if (params.mipmaps) {
+			// level n shrinks the padding to padding >> n texels, past that neighbours bleed in
+			int maxLevel = 0;
+			while ((padding >> (maxLevel + 1)) >= 1) {
+				maxLevel++;
+			}
+			GLint previous = 0;
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+			glBindTexture(GL_TEXTURE_2D, atlas.texture.id());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+			glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+		}
+		return atlas;
+	}
+
+private:
+	struct Image {
+		std::string name;
+		int width = 0;
+		int height = 0;
+		std::vector<unsigned char> rgba;
+	};
+
+	int padding;
+	std::vector<Image> images;
+
+	// copies the image with its padding to (x, y), the padding repeats the edge pixels
+	void blit(const Image& image, int x, int y, int atlasWidth, unsigned char* atlas) const {
+		for (int row = -padding; row < image.height + padding; ++row) {
+			int sourceRow = std::min(std::max(row, 0), image.height - 1);
+			unsigned char* target = atlas + ((size_t)(y + padding + row) * atlasWidth + x) * 4;
+			const unsigned char* source = image.rgba.data() + (size_t)sourceRow * image.width * 4;
+			for (int column = -padding; column < image.width + padding; ++column) {
+				int sourceColumn = std::min(std::max(column, 0), image.width - 1);
+				std::memcpy(target, source + sourceColumn * 4, 4);
+				target += 4;
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,335 @@
+#pragma once
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include "./GLObjects.h"
+#include "./Texture.h"
+#include "./LockFreeQueue.h"
+#include "./PixelUploadRing.h"
+#include "./CookedTexture.h"
+
+#include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// decodes images on a pool of worker threads and uploads them on the GL thread
+// load() only queues the file, the workers stbi_load in parallel and push finished images
+// onto a lock-free queue, pump() drains that queue each frame until its time budget is
+// spent, so hundreds of textures load about as fast as there are cores to decode them
+// and no single frame pays for all the uploads
+// given a PixelUploadRing the workers also copy the pixels into its staging buffers, so
+// the GL thread only has to issue the copy out of the buffer
+// .lotx paths (see CookedTexture.h) skip all of that: the worker maps the file and pages it
+// in, the GL thread uploads straight from the mapping
+class TextureLoader {
+public:
+	// the texture is handed over on the GL thread, from inside pump()/finish()
+	typedef std::function<void(GLTexture texture, const TextureImage& image)> LoadedCallback;
+	// asked on the GL thread right before the upload, false skips it and onLoaded with it
+	// (TextureManager uses it to reuse a texture with the same contentHash)
+	typedef std::function<bool(const TextureImage& image)> UploadFilter;
+	// GL thread too, when the file couldn't be decoded (or mapped) or the upload made no texture,
+	// image.error says why
+	typedef std::function<void(const TextureImage& image)> FailedCallback;
+
+	// 0 threads means one per core, minus the one running the GL thread
+	// the staging ring has to outlive the loader, images too big for its slots skip it
+	explicit TextureLoader(unsigned int threads = 0, PixelUploadRing* staging = nullptr) : decoded(256), staging(staging) {
+		if (threads == 0) {
+			unsigned int cores = std::thread::hardware_concurrency();
+			threads = cores > 1 ? cores - 1 : 1;
+		}
+		running = true;
+		for (unsigned int i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(&TextureLoader::work, this));
+		}
+	}
+
+	~TextureLoader() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// GL thread, returns immediately
+	// files that fail to decode are reported and never reach `onLoaded`, only `onFailed`
+	void load(const std::string& path, const TextureParams& params, const LoadedCallback& onLoaded, const UploadFilter& filter = UploadFilter(),
+		const FailedCallback& onFailed = FailedCallback()) {
+		unsigned int ticket = nextTicket++;
+		Request& request = requests[ticket];
+		request.params = params;
+		request.onLoaded = onLoaded;
+		request.filter = filter;
+		request.onFailed = onFailed;
+		// the workers can't ask the GL, so find out here whether compressing is any use
+		TextureParams decodeParams = params;
+		decodeParams.compress = params.compress && canUploadCompressed(params);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(Job{ ticket, path, decodeParams });
+		}
+		wake.notify_one();
+	}
+
+	// GL thread, uploads finished images until `budgetMs` is used up (always at least one)
+	// returns how many textures were uploaded
+	size_t pump(double budgetMs) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (staging) {
+			staging->recycle();
+		}
+		size_t uploaded = 0;
+		Decoded result;
+		while (decoded.tryPop(result)) {
+			deliver(result);
+			uploaded++;
+			double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (elapsedMs >= budgetMs) {
+				break;
+			}
+		}
+		return uploaded;
+	}
+
+	// GL thread, waits for and uploads everything still outstanding (loading screens)
+	void finish() {
+		while (!requests.empty()) {
+			if (pump(1e9) == 0) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// loads queued or decoding or waiting for upload
+	size_t outstanding() const {
+		return requests.size();
+	}
+
+	size_t threadCount() const {
+		return workers.size();
+	}
+
+	// 1x1 opaque grey texture to draw with until the real image is up (see StreamedTexture)
+	// created on first use, owned by the loader
+	GLuint placeholder() {
+		if (!placeholderTexture) {
+			const unsigned char grey[4] = { 128, 128, 128, 255 };
+			placeholderTexture = GLTexture::create();
+			GLint previous = 0;
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+			glBindTexture(GL_TEXTURE_2D, placeholderTexture.id());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // no mipmaps to be complete without
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			allocateTextureStorage2D(1, GL_RGBA8, GL_RGBA, 1, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+			glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+		}
+		return placeholderTexture.id();
+	}
+
+private:
+	struct Job {
+		unsigned int ticket;
+		std::string path;
+		TextureParams params;
+	};
+	struct Decoded {
+		unsigned int ticket = 0;
+		TextureImage image;
+		int stagingSlot = -1; // the pixels are in this slot of the ring instead of image.pixels
+		int stagingLevels = 0;
+		std::shared_ptr<CookedTexture> cooked; // mapped .lotx file to upload from instead of image
+	};
+	// what the GL thread remembers about a load, workers never see these
+	struct Request {
+		TextureParams params;
+		LoadedCallback onLoaded;
+		UploadFilter filter;
+		FailedCallback onFailed;
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex; // guards jobs, running is only changed while holding it
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	std::atomic<bool> running;
+	LockFreeQueue<Decoded> decoded; // workers -> GL thread
+	PixelUploadRing* staging;
+	std::map<unsigned int, Request> requests; // GL thread only
+	unsigned int nextTicket = 0;
+	GLTexture placeholderTexture;
+
+	void work() {
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return !running || !jobs.empty(); });
+				if (!running) {
+					return;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+			}
+
+			Decoded result;
+			result.ticket = job.ticket;
+			if (isCookedTexturePath(job.path)) {
+				mapCooked(job.path, result);
+				if (!pushDecoded(result)) {
+					return;
+				}
+				continue;
+			}
+			result.image = TextureImage::decode(job.path, job.params.flipVertically);
+			if (result.image) {
+				result.image.contentHash = hashTextureContent(result.image.pixels.get(), result.image.byteSize(),
+					((unsigned long long)result.image.width << 32) ^ ((unsigned long long)result.image.height << 8) ^ (unsigned long long)result.image.channels);
+			}
+			// compressed textures can't glGenerateMipmap, so compressing always builds the chain here
+			if (job.params.mipmaps && (job.params.cpuMipmaps || job.params.compress)) {
+				result.image.generateMips(job.params.srgb);
+			}
+			if (job.params.compress) {
+				result.image.compress(1); // the pool already keeps every core busy
+			}
+			if (staging && result.image && result.image.chainByteSize() <= staging->slotBytes()) {
+				// slots come back as the GL thread's copies finish, every pump()
+				while ((result.stagingSlot = staging->tryAcquire()) < 0) {
+					if (!running) {
+						return;
+					}
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+				}
+				unsigned char* memory = staging->memory(result.stagingSlot);
+				std::memcpy(memory, result.image.pixels.get(), result.image.byteSize());
+				memory += result.image.byteSize();
+				for (const MipLevel& level : result.image.mips) {
+					std::memcpy(memory, level.pixels.data(), level.pixels.size());
+					memory += level.pixels.size();
+				}
+				result.stagingLevels = 1 + (int)result.image.mips.size();
+				result.image.pixels.reset();
+				result.image.mips.clear();
+			}
+			if (!pushDecoded(result)) {
+				return;
+			}
+		}
+	}
+
+	// worker, everything the GL thread needs to know is in the mapped header
+	void mapCooked(const std::string& path, Decoded& result) {
+		result.image.path = path;
+		result.cooked = std::make_shared<CookedTexture>();
+		if (!result.cooked->open(path)) {
+			result.image.error = result.cooked->error();
+			result.cooked.reset();
+			return;
+		}
+		// the page faults happen here rather than in the upload on the GL thread
+		result.cooked->prefault();
+		result.image.width = result.cooked->header().width;
+		result.image.height = result.cooked->header().height;
+		result.image.channels = result.cooked->header().channels;
+		// cooked bytes differ from decoded ones, so the format goes into the seed and a cooked
+		// texture only ever matches other cooked textures
+		const CookedTextureHeader& header = result.cooked->header();
+		result.image.contentHash = hashTextureContent(result.cooked->levelData(0), (size_t)result.cooked->level(0).size,
+			((unsigned long long)header.width << 32) ^ ((unsigned long long)header.height << 8) ^ ((unsigned long long)header.internalFormat << 16));
+	}
+
+	// worker, false if the loader shut down while the GL thread wasn't keeping up
+	bool pushDecoded(Decoded& result) {
+		// the GL thread isn't keeping up, wait for it to make room
+		while (!decoded.tryPush(result)) {
+			if (!running) {
+				if (result.stagingSlot >= 0) {
+					staging->release(result.stagingSlot);
+				}
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	void deliver(Decoded& result) {
+		std::map<unsigned int, Request>::iterator request = requests.find(result.ticket);
+		if (request == requests.end()) {
+			if (result.stagingSlot >= 0) {
+				staging->release(result.stagingSlot);
+			}
+			return;
+		}
+		TextureImage& image = result.image;
+		const TextureParams& params = request->second.params;
+		if (!image.error.empty()) {
+			std::cout << "ERROR::TEXTURE::LOAD_FAILED " << image.path << ": " << image.error << std::endl;
+			if (request->second.onFailed) {
+				request->second.onFailed(image);
+			}
+		}
+		else if (request->second.filter && !request->second.filter(image)) {
+			if (result.stagingSlot >= 0) {
+				staging->release(result.stagingSlot);
+			}
+		}
+		else {
+			GLTexture texture;
+			if (result.cooked) {
+				const CookedTextureHeader& header = result.cooked->header();
+				texture = uploadCookedTexture(*result.cooked, params);
+				image.internalFormat = header.internalFormat;
+				image.levels = header.levelCount;
+			}
+			else if (!image.compressed.levels.empty()) {
+				// compressed images are a fraction of the size and always upload from client memory
+				texture = uploadCompressedTexture2D(image.compressed, params);
+				image.internalFormat = compressedFormatFor(image.compressed.format, params.srgb);
+				image.levels = (int)image.compressed.levels.size();
+			}
+			else {
+				texture = result.stagingSlot >= 0
+					? staging->upload(result.stagingSlot, image.width, image.height, image.channels, result.stagingLevels, params)
+					: uploadTexture2D(image, params);
+				image.internalFormat = textureInternalFormatFor(image.channels, params.srgb);
+				image.levels = params.mipmaps ? mipLevelCount(image.width, image.height) : 1;
+			}
+			image.textureBytes = textureStorageBytes(image.internalFormat, image.width, image.height, image.levels);
+			if (!texture) {
+				image.error = "upload failed";
+				if (request->second.onFailed) {
+					request->second.onFailed(image);
+				}
+			}
+			else if (request->second.onLoaded) {
+				request->second.onLoaded(std::move(texture), image);
+			}
+		}
+		result.cooked.reset(); // unmapped now, the GL has its own copy
+		requests.erase(request);
+	}
+};
+
+#endif
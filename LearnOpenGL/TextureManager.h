@@ -0,0 +1,473 @@
+#pragma once
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./Texture.h"
+#include "./TextureLoader.h"
+
+#include <string>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+// one GL texture and what it takes to shrink it or load it again
+// shared by every handle (and every path) that resolved to the same pixels
+struct ResidentTexture {
+	GLTexture texture; // empty while evicted
+	std::string path;  // loaded again from here when it's needed at full size
+	TextureParams params;
+	GLenum internalFormat = 0;
+	int channels = 0;
+	int width = 0; // of the full texture
+	int height = 0;
+	int levels = 0;
+	int droppedLevels = 0; // top levels not resident right now, texture's level 0 is this level of the full chain
+	size_t fullBytes = 0;
+	size_t bytes = 0; // resident right now
+	unsigned long long lastUsedFrame = 0;
+	bool restoring = false; // a reload is on its way
+	unsigned long long retryFrame = 0; // a failed reload isn't tried again before this frame
+	std::shared_ptr<const unsigned long long> clock; // the manager's frame counter
+};
+
+// a shared, reference counted texture from a TextureManager
+// draws with the loader's placeholder until the image streamed in (and while it's evicted),
+// like StreamedTexture, the texture is deleted when the last handle to it goes away
+class TextureHandle {
+public:
+	TextureHandle() {}
+
+	explicit operator bool() const {
+		return entry != nullptr;
+	}
+
+	// what to bind this frame
+	GLuint id() const {
+		if (!entry) {
+			return 0;
+		}
+		return entry->resident && entry->resident->texture ? entry->resident->texture.id() : entry->placeholder;
+	}
+
+	// true once the real image replaced the placeholder (possibly with its top mips dropped)
+	bool streamedIn() const {
+		return entry && entry->resident && entry->resident->texture;
+	}
+
+	// size of the full image, 0 until it streamed in
+	int width() const {
+		return entry && entry->resident ? entry->resident->width : 0;
+	}
+	int height() const {
+		return entry && entry->resident ? entry->resident->height : 0;
+	}
+	// video memory the texture takes right now
+	size_t bytes() const {
+		return entry && entry->resident ? entry->resident->bytes : 0;
+	}
+	// mip levels the memory budget took away, 0 at full resolution
+	int droppedLevels() const {
+		return entry && entry->resident ? entry->resident->droppedLevels : 0;
+	}
+
+	// handles sharing this texture, this one included
+	long useCount() const {
+		return entry.use_count();
+	}
+
+	// marks the texture as used this frame, which is what keeps it resident, and gives id()
+	// for code that binds it later (a DrawCommand, say)
+	GLuint touch() const {
+		if (entry && entry->resident) {
+			entry->resident->lastUsedFrame = *entry->resident->clock;
+		}
+		return id();
+	}
+
+	void bind(GLuint unit) const {
+		glState().bindTexture(unit, GL_TEXTURE_2D, touch());
+	}
+
+private:
+	friend class TextureManager;
+
+	// one per path + params, entries of different paths with identical pixels share `resident`
+	struct Entry {
+		GLuint placeholder = 0;
+		std::shared_ptr<ResidentTexture> resident;
+		unsigned int pendingHits = 0; // acquire() hits before it streamed in, counted as saved once it does
+	};
+	std::shared_ptr<Entry> entry;
+
+	explicit TextureHandle(const std::shared_ptr<Entry>& entry) : entry(entry) {}
+};
+
+// hands out shared textures so nothing is decoded or uploaded twice
+// a path that's already loaded (or loading) with the same params is a hit and shares the handle,
+// anything else is a miss and goes to the TextureLoader, whose workers hash the decoded pixels:
+// if another path turns out to hold identical pixels under the same params, that texture is
+// reused and the upload skipped
+// params are part of both keys since wrapping, filtering and flipping live in the texture object
+//
+// with a memory budget, endFrame() keeps the resident textures under it: the least recently
+// bound ones first lose their top mip levels (down to MIN_DROPPED_SIZE) and are evicted
+// altogether only if that isn't enough, a texture bound again is reloaded at full size
+// textures bound in the current frame are never touched, so a working set bigger than the
+// budget just goes over it instead of thrashing
+// GL thread only, the loader has to outlive the manager
+class TextureManager {
+public:
+	struct Stats {
+		unsigned int hits = 0;        // acquire() found the path already loaded or loading
+		unsigned int misses = 0;      // acquire() had to start a load
+		unsigned int contentHits = 0; // loads whose pixels matched an existing texture, upload skipped
+		size_t bytesSaved = 0;        // video memory (and uploads) not spent on duplicates
+		unsigned int mipDrops = 0;    // textures shrunk by dropping top levels
+		unsigned int evictions = 0;   // textures deleted to make room
+		unsigned int restores = 0;    // shrunk or evicted textures loaded again at full size
+	};
+
+	// the top level of a shrunk texture stays at least this big (or the whole chain is kept)
+	static const int MIN_DROPPED_SIZE = 64;
+	// frames before a reload that failed (file gone, bad data) is tried again
+	static const unsigned long long RESTORE_RETRY_FRAMES = 300;
+
+	explicit TextureManager(TextureLoader& loader) : loader(loader), registry(std::make_shared<Registry>()) {}
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// returns straight away, the handle streams in during TextureLoader::pump()
+	TextureHandle acquire(const std::string& path, const TextureParams& params) {
+		Registry& textures = *registry;
+		RequestKey key(path, paramsKeyHigh(params), paramsKeyLow(params));
+		std::map<RequestKey, std::weak_ptr<TextureHandle::Entry>>::iterator found = textures.byRequest.find(key);
+		if (found != textures.byRequest.end()) {
+			std::shared_ptr<TextureHandle::Entry> alive = found->second.lock();
+			if (alive) {
+				textures.stats.hits++;
+				if (alive->resident) {
+					textures.stats.bytesSaved += alive->resident->fullBytes;
+				}
+				else {
+					alive->pendingHits++;
+				}
+				return TextureHandle(alive);
+			}
+		}
+
+		textures.stats.misses++;
+		prune();
+		std::shared_ptr<TextureHandle::Entry> entry = std::make_shared<TextureHandle::Entry>();
+		entry->placeholder = loader.placeholder();
+		textures.byRequest[key] = entry;
+
+		// weak so released handles (or a destroyed manager) just make the load a no-op
+		std::weak_ptr<Registry> weakRegistry = registry;
+		std::weak_ptr<TextureHandle::Entry> target = entry;
+		unsigned long long high = std::get<1>(key), low = std::get<2>(key);
+		loader.load(path, params,
+			[weakRegistry, target, high, low, path, params](GLTexture texture, const TextureImage& image) {
+				std::shared_ptr<Registry> textures = weakRegistry.lock();
+				std::shared_ptr<TextureHandle::Entry> alive = target.lock();
+				if (!textures || !alive) {
+					return;
+				}
+				std::shared_ptr<ResidentTexture> resident = std::make_shared<ResidentTexture>();
+				resident->texture = std::move(texture);
+				resident->path = path;
+				resident->params = params;
+				resident->internalFormat = image.internalFormat;
+				resident->channels = image.channels;
+				resident->width = image.width;
+				resident->height = image.height;
+				resident->levels = image.levels;
+				resident->fullBytes = image.textureBytes;
+				resident->bytes = image.textureBytes;
+				resident->lastUsedFrame = *textures->clock; // fresh, not a candidate for eviction yet
+				resident->clock = textures->clock;
+				alive->resident = resident;
+				textures->stats.bytesSaved += resident->fullBytes * alive->pendingHits;
+				alive->pendingHits = 0;
+				textures->byContent[ContentKey(image.contentHash, high, low)] = resident;
+			},
+			[weakRegistry, target, high, low](const TextureImage& image) {
+				std::shared_ptr<Registry> textures = weakRegistry.lock();
+				std::shared_ptr<TextureHandle::Entry> alive = target.lock();
+				if (!textures || !alive) {
+					return false; // nobody wants it anymore
+				}
+				std::map<ContentKey, std::weak_ptr<ResidentTexture>>::iterator same = textures->byContent.find(ContentKey(image.contentHash, high, low));
+				std::shared_ptr<ResidentTexture> existing = same != textures->byContent.end() ? same->second.lock() : nullptr;
+				if (!existing) {
+					return true;
+				}
+				alive->resident = existing;
+				textures->stats.contentHits++;
+				textures->stats.bytesSaved += existing->fullBytes * (1 + alive->pendingHits);
+				alive->pendingHits = 0;
+				return false;
+			});
+		return TextureHandle(entry);
+	}
+
+	// video memory endFrame() keeps the textures under, unlimited by default
+	void setBudget(size_t bytes) {
+		registry->budget = bytes;
+	}
+	size_t budget() const {
+		return registry->budget;
+	}
+
+	// GL thread, once per frame after the last bind(): starts reloading shrunk or evicted
+	// textures that were bound this frame, then shrinks and evicts what wasn't until the
+	// resident textures fit the budget
+	void endFrame() {
+		Registry& textures = *registry;
+		unsigned long long frame = *textures.clock;
+		std::vector<std::shared_ptr<ResidentTexture>> residents = liveResidents();
+
+		size_t resident = 0;
+		std::vector<ResidentTexture*> candidates;
+		for (const std::shared_ptr<ResidentTexture>& texture : residents) {
+			resident += texture->bytes;
+			if (texture->lastUsedFrame == frame) {
+				if ((texture->droppedLevels > 0 || !texture->texture) && !texture->restoring && frame >= texture->retryFrame) {
+					restore(texture);
+				}
+			}
+			else if (texture->texture && !texture->restoring) {
+				candidates.push_back(texture.get());
+			}
+		}
+
+		if (resident > textures.budget) {
+			// least recently used first
+			std::sort(candidates.begin(), candidates.end(), [](const ResidentTexture* a, const ResidentTexture* b) {
+				return a->lastUsedFrame < b->lastUsedFrame;
+			});
+			// as few levels as it takes, so what's old degrades before anything disappears
+			for (size_t i = 0; i < candidates.size() && resident > textures.budget; ++i) {
+				ResidentTexture& texture = *candidates[i];
+				int count = 0;
+				size_t after = texture.bytes;
+				while (count < droppableLevels(texture) && resident - (texture.bytes - after) > textures.budget) {
+					count++;
+					after = bytesWithout(texture, texture.droppedLevels + count);
+				}
+				if (count > 0) {
+					resident -= texture.bytes;
+					dropTopLevels(texture, count);
+					resident += texture.bytes;
+					textures.stats.mipDrops++;
+				}
+			}
+			for (size_t i = 0; i < candidates.size() && resident > textures.budget; ++i) {
+				ResidentTexture& texture = *candidates[i];
+				resident -= texture.bytes;
+				texture.texture.reset();
+				texture.bytes = 0;
+				textures.stats.evictions++;
+			}
+		}
+		textures.residentBytes = resident;
+		++*textures.clock;
+	}
+
+	// video memory of every texture as of the last endFrame()
+	size_t residentBytes() const {
+		return registry->residentBytes;
+	}
+
+	// distinct GL textures currently alive
+	size_t textureCount() const {
+		size_t count = 0;
+		for (const std::pair<const ContentKey, std::weak_ptr<ResidentTexture>>& content : registry->byContent) {
+			count += content.second.expired() ? 0 : 1;
+		}
+		return count;
+	}
+
+	const Stats& getStats() const {
+		return registry->stats;
+	}
+
+	void printStats() const {
+		const Stats& stats = registry->stats;
+		std::cout << "texture manager: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.contentHits
+			<< " duplicates by content, " << stats.bytesSaved / 1024 << " KB saved" << std::endl;
+		if (registry->budget != std::numeric_limits<size_t>::max()) {
+			std::cout << "  " << registry->residentBytes / 1024 << " KB resident of a " << registry->budget / 1024 << " KB budget, "
+				<< stats.mipDrops << " mip drops, " << stats.evictions << " evictions, " << stats.restores << " restores" << std::endl;
+		}
+	}
+
+private:
+	// path, packed wrap/filter enums, packed flags
+	typedef std::tuple<std::string, unsigned long long, unsigned long long> RequestKey;
+	// content hash and the same packed params
+	typedef std::tuple<unsigned long long, unsigned long long, unsigned long long> ContentKey;
+
+	// shared with the load callbacks, which may run after the manager is gone
+	struct Registry {
+		std::map<RequestKey, std::weak_ptr<TextureHandle::Entry>> byRequest;
+		std::map<ContentKey, std::weak_ptr<ResidentTexture>> byContent; // every live texture is in here once
+		std::shared_ptr<unsigned long long> clock = std::make_shared<unsigned long long>(0);
+		size_t budget = std::numeric_limits<size_t>::max();
+		size_t residentBytes = 0;
+		Stats stats;
+	};
+
+	TextureLoader& loader;
+	std::shared_ptr<Registry> registry;
+
+	// GL enums all fit in 16 bits
+	static unsigned long long paramsKeyHigh(const TextureParams& params) {
+		return ((unsigned long long)(params.wrapS & 0xFFFF) << 48) | ((unsigned long long)(params.wrapT & 0xFFFF) << 32)
+			| ((unsigned long long)(params.minFilter & 0xFFFF) << 16) | (unsigned long long)(params.magFilter & 0xFFFF);
+	}
+	static unsigned long long paramsKeyLow(const TextureParams& params) {
+		return (params.mipmaps ? 1ull : 0) | (params.cpuMipmaps ? 2ull : 0) | (params.compress ? 4ull : 0)
+			| (params.flipVertically ? 8ull : 0) | (params.srgb ? 16ull : 0);
+	}
+
+	// forget what every handle has let go of
+	void prune() {
+		for (std::map<RequestKey, std::weak_ptr<TextureHandle::Entry>>::iterator it = registry->byRequest.begin(); it != registry->byRequest.end();) {
+			it = it->second.expired() ? registry->byRequest.erase(it) : std::next(it);
+		}
+		for (std::map<ContentKey, std::weak_ptr<ResidentTexture>>::iterator it = registry->byContent.begin(); it != registry->byContent.end();) {
+			it = it->second.expired() ? registry->byContent.erase(it) : std::next(it);
+		}
+	}
+
+	std::vector<std::shared_ptr<ResidentTexture>> liveResidents() const {
+		std::vector<std::shared_ptr<ResidentTexture>> residents;
+		for (const std::pair<const ContentKey, std::weak_ptr<ResidentTexture>>& content : registry->byContent) {
+			std::shared_ptr<ResidentTexture> alive = content.second.lock();
+			if (alive) {
+				residents.push_back(alive);
+			}
+		}
+		return residents;
+	}
+
+	static int levelSize(int size, int level) {
+		size >>= level;
+		return size > 1 ? size : 1;
+	}
+
+	// how many more top levels can go before the new top level is smaller than MIN_DROPPED_SIZE
+	static int droppableLevels(const ResidentTexture& texture) {
+		int count = 0;
+		int next = texture.droppedLevels + 1;
+		while (next < texture.levels && std::max(levelSize(texture.width, next), levelSize(texture.height, next)) >= MIN_DROPPED_SIZE) {
+			count++;
+			next++;
+		}
+		return count;
+	}
+
+	static size_t bytesWithout(const ResidentTexture& texture, int droppedLevels) {
+		return textureStorageBytes(texture.internalFormat, levelSize(texture.width, droppedLevels), levelSize(texture.height, droppedLevels),
+			texture.levels - droppedLevels);
+	}
+
+	// replaces the texture with a smaller one holding the lower `count` levels of it
+	// a GPU side copy with ARB_copy_image, otherwise the levels take a round trip through
+	// client memory (small, they're a quarter of the texture at most)
+	static void dropTopLevels(ResidentTexture& texture, int count) {
+		int dropped = texture.droppedLevels + count;
+		int levels = texture.levels - dropped;
+		bool compressed = isCompressedTextureFormat(texture.internalFormat);
+		GLenum format = textureFormatFor(texture.channels);
+		GLTexture smaller = GLTexture::create();
+
+		GLint previous = 0, packAlignment = 4, unpackAlignment = 4;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+		glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		glBindTexture(GL_TEXTURE_2D, smaller.id());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.params.wrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.params.wrapT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.params.magFilter);
+		allocateTextureStorage2D(levels, texture.internalFormat, format, levelSize(texture.width, dropped), levelSize(texture.height, dropped));
+
+		std::vector<unsigned char> pixels;
+		for (int level = 0; level < levels; ++level) {
+			int width = levelSize(texture.width, dropped + level);
+			int height = levelSize(texture.height, dropped + level);
+			GLint source = level + count; // level of the current texture
+			if (glExt().copyImage) {
+				glExt().CopyImageSubData(texture.texture.id(), GL_TEXTURE_2D, source, 0, 0, 0, smaller.id(), GL_TEXTURE_2D, level, 0, 0, 0, width, height, 1);
+				continue;
+			}
+			glBindTexture(GL_TEXTURE_2D, texture.texture.id());
+			if (compressed) {
+				GLint size = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, source, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+				pixels.resize((size_t)size);
+				glGetCompressedTexImage(GL_TEXTURE_2D, source, pixels.data());
+				glBindTexture(GL_TEXTURE_2D, smaller.id());
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, texture.internalFormat, size, pixels.data());
+			}
+			else {
+				pixels.resize((size_t)width * height * texture.channels);
+				glGetTexImage(GL_TEXTURE_2D, source, format, GL_UNSIGNED_BYTE, pixels.data());
+				glBindTexture(GL_TEXTURE_2D, smaller.id());
+				glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels.data());
+			}
+		}
+
+		glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+		glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+		texture.texture = std::move(smaller);
+		texture.droppedLevels = dropped;
+		texture.bytes = bytesWithout(texture, dropped);
+	}
+
+	// loads the full texture again, it replaces the shrunk one (or the placeholder) when it's up
+	void restore(const std::shared_ptr<ResidentTexture>& texture) {
+		texture->restoring = true;
+		std::weak_ptr<Registry> weakRegistry = registry;
+		std::weak_ptr<ResidentTexture> target = texture;
+		loader.load(texture->path, texture->params, [weakRegistry, target](GLTexture full, const TextureImage&) {
+			std::shared_ptr<ResidentTexture> alive = target.lock();
+			if (!alive) {
+				return;
+			}
+			alive->texture = std::move(full);
+			alive->droppedLevels = 0;
+			alive->bytes = alive->fullBytes;
+			alive->restoring = false;
+			std::shared_ptr<Registry> textures = weakRegistry.lock();
+			if (textures) {
+				textures->stats.restores++;
+			}
+		}, TextureLoader::UploadFilter(), [target](const TextureImage&) {
+			// keep what's resident and try again later rather than every frame the texture is bound
+			std::shared_ptr<ResidentTexture> alive = target.lock();
+			if (alive) {
+				alive->restoring = false;
+				alive->retryFrame = *alive->clock + RESTORE_RETRY_FRAMES;
+			}
+		});
+	}
+};
+
+#endif
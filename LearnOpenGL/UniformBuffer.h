@@ -0,0 +1,130 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./StreamRing.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// std140 building blocks for C++ mirrors of GLSL uniform blocks
+// scalars align to 4 bytes, vec2 to 8, vec4 (and every array element/matrix column) to 16
+// there's deliberately no vec3: GLSL packs a float right after it, C++ can't, use vec4
+struct alignas(16) Std140Vec4 {
+	float x, y, z, w;
+};
+struct alignas(8) Std140Vec2 {
+	float x, y;
+};
+struct alignas(16) Std140Mat4 {
+	Std140Vec4 columns[4];
+};
+
+// compile-time check that a mirrored member sits where std140 puts it
+#define STD140_ASSERT_OFFSET(type, member, offset) \
+	static_assert(offsetof(type, member) == (offset), #type "::" #member " is not at std140 offset " #offset)
+// blocks are sized in whole vec4s
+#define STD140_ASSERT_SIZE(type, size) \
+	static_assert(sizeof(type) == (size) && sizeof(type) % 16 == 0, #type " does not match its std140 block size")
+
+// hands out one binding point per block name, so every program that declares
+// `uniform FrameData {...}` reads the same buffer without any per-program setup
+// there are only GL_MAX_UNIFORM_BUFFER_BINDINGS points (36 on some 3.3 drivers), names past
+// that get NO_POINT and are left unbound
+class UniformBlockBindings {
+public:
+	static const GLuint NO_POINT = 0xFFFFFFFFu;
+
+	// needs a current context the first time, for the limit
+	static GLuint pointFor(const std::string& blockName) {
+		std::vector<std::string>& names = blockNames();
+		for (size_t i = 0; i < names.size(); ++i) {
+			if (names[i] == blockName) {
+				return (GLuint)i;
+			}
+		}
+		static const GLuint limit = maxBindings();
+		if (names.size() >= limit) {
+			std::cout << "ERROR::UNIFORM_BUFFER::OUT_OF_BINDING_POINTS all " << limit
+				<< " are taken, uniform block " << blockName << " stays unbound" << std::endl;
+			return NO_POINT;
+		}
+		names.push_back(blockName);
+		return (GLuint)names.size() - 1;
+	}
+
+private:
+	static GLuint maxBindings() {
+		GLint limit = 36; // the minimum 3.3 guarantees
+		glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &limit);
+		return (GLuint)limit;
+	}
+
+	static std::vector<std::string>& blockNames() {
+		static std::vector<std::string> names;
+		return names;
+	}
+};
+
+// a uniform buffer holding one T, bound to the binding point of `blockName`
+// update once per frame instead of one glUniform* per value per program
+template <typename T>
+class UniformBuffer {
+public:
+	explicit UniformBuffer(const std::string& blockName)
+		: buffer(GLBuffer::create()), bindingPoint(UniformBlockBindings::pointFor(blockName)) {
+		static_assert(sizeof(T) % 16 == 0, "std140 blocks are a whole number of vec4s");
+		glState().bindBuffer(GL_UNIFORM_BUFFER, buffer.id());
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+		if (bindingPoint != UniformBlockBindings::NO_POINT) {
+			glState().bindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer.id());
+		}
+	}
+
+	// left bound to GL_UNIFORM_BUFFER, so updating the same block again skips the bind
+	void update(const T& data) {
+		if (streamed && bindingPoint != UniformBlockBindings::NO_POINT) {
+			glState().bindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer.id());
+			streamed = false;
+		}
+		glState().bindBuffer(GL_UNIFORM_BUFFER, buffer.id());
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+	}
+
+	// writes this frame's copy into `ring` instead and points the binding at it, no
+	// glBufferSubData and no wait for draws still reading an older copy
+	void update(const T& data, StreamRing& ring) {
+		if (bindingPoint == UniformBlockBindings::NO_POINT) {
+			return; // no program could read it anyway
+		}
+		StreamRing::Allocation allocation = ring.allocate(sizeof(T), ring.uniformAlignment());
+		if (!allocation) {
+			return;
+		}
+		std::memcpy(allocation.memory, &data, sizeof(T));
+		ring.commit(allocation);
+		glState().bindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, ring.id(), allocation.offset, sizeof(T));
+		streamed = true;
+	}
+
+	GLuint id() const {
+		return buffer.id();
+	}
+	// UniformBlockBindings::NO_POINT if the binding points ran out
+	GLuint binding() const {
+		return bindingPoint;
+	}
+
+private:
+	GLBuffer buffer;
+	GLuint bindingPoint;
+	bool streamed = false; // the binding points into a StreamRing
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./Texture.h"
+#include "./CookedTexture.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+
+// loads the demo textures the way texMain used to (stb_image decode, CPU mips, BC1/BC3) and from
+// their cooked .lotx files (map, upload), and reports the time until each texture is usable
+// cold is the first load of each file in this process, warm the mean of the loads after it
+// the OS page cache isn't flushed, so cold means cold for this process (first stb_image and
+// first mapping), for cold-from-disk numbers drop the page cache before starting
+const int cookedBenchWARM_ITERATIONS = 20;
+
+static double cookedBenchMsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// decode to finished texture, glFinish() so the upload has really happened
+static double cookedBenchLoadSource(const char* file, const TextureParams& params) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	TextureImage image = TextureImage::decode(file, params.flipVertically);
+	if (!image) {
+		std::cout << "Failed to load " << file << ": " << image.error << std::endl;
+		return 0.0;
+	}
+	image.generateMips(params.srgb);
+	if (params.compress) {
+		image.compress(1);
+	}
+	GLTexture texture = !image.compressed.levels.empty() ? uploadCompressedTexture2D(image.compressed, params) : uploadTexture2D(image, params);
+	glFinish();
+	return cookedBenchMsSince(start);
+}
+
+static double cookedBenchLoadCooked(const std::string& path, const TextureParams& params) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CookedTexture cooked;
+	if (!cooked.open(path)) {
+		std::cout << "Failed to map " << path << ": " << cooked.error() << std::endl;
+		return 0.0;
+	}
+	GLTexture texture = uploadCookedTexture(cooked, params);
+	glFinish();
+	return cookedBenchMsSince(start);
+}
+
+int cookedTextureBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Cooked Texture Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	// what texMain loads with
+	TextureParams params;
+	params.minFilter = GL_NEAREST;
+	params.magFilter = GL_NEAREST;
+	params.cpuMipmaps = true;
+	params.compress = canUploadCompressed(params);
+
+	const char* files[] = { "container.jpg", "awesomeface.png" };
+	const int fileCount = 2;
+	std::string cookedPaths[fileCount];
+	double coldSource[fileCount], coldCooked[fileCount];
+
+	// cooked up front so neither path is timed right after the other wrote its file
+	for (int i = 0; i < fileCount; ++i) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		cookedPaths[i] = cookTextureIfStale(files[i], params);
+		std::cout << "cooked " << files[i] << " -> " << cookedPaths[i] << " in " << cookedBenchMsSince(start) << " ms" << std::endl;
+	}
+
+	// cold: the first load of every file, cooked first so stb_image's one-time setup isn't counted against it
+	for (int i = 0; i < fileCount; ++i) {
+		coldCooked[i] = cookedBenchLoadCooked(cookedPaths[i], params);
+	}
+	for (int i = 0; i < fileCount; ++i) {
+		coldSource[i] = cookedBenchLoadSource(files[i], params);
+	}
+
+	std::cout << "time to a usable texture (" << (params.compress ? "BC1/BC3" : "uncompressed") << ", full mip chain), warm is the mean of "
+		<< cookedBenchWARM_ITERATIONS << " loads" << std::endl;
+	for (int i = 0; i < fileCount; ++i) {
+		double warmSource = 0.0, warmCooked = 0.0;
+		for (int run = 0; run < cookedBenchWARM_ITERATIONS; ++run) {
+			warmSource += cookedBenchLoadSource(files[i], params);
+			warmCooked += cookedBenchLoadCooked(cookedPaths[i], params);
+		}
+		warmSource /= cookedBenchWARM_ITERATIONS;
+		warmCooked /= cookedBenchWARM_ITERATIONS;
+		std::cout << "  " << files[i] << ": stb_image cold " << coldSource[i] << " ms, warm " << warmSource << " ms | cooked cold "
+			<< coldCooked[i] << " ms, warm " << warmCooked << " ms (" << warmSource / warmCooked << "x)" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,236 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./GLStateCache.h"
+#include "./DrawQueue.h"
+#include "./Shader.h"
+#include "./Texture.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// submits the same sprites in random order every frame and draws them three ways: inline in
+// submission order (every bind issued), through the queue unsorted (the state cache alone) and
+// through the queue sorted, reporting state switches, GL calls and CPU time per frame
+// also times the radix sort against std::sort on the same keys
+const int drawQueueBenchPROGRAMS = 8;
+const int drawQueueBenchTEXTURES = 64;
+const int drawQueueBenchVERTEX_ARRAYS = 16;
+const int drawQueueBenchDRAWS = 20000;
+const int drawQueueBenchFRAMES = 50;
+
+static const char* drawQueueBenchVertex = R"(#version 330 core
+layout (location = 0) in vec2 aCorner;
+uniform vec4 sprite; // xy offset, zw size
+out vec2 texCoord;
+void main() {
+	gl_Position = vec4(sprite.xy + aCorner * sprite.zw, 0.0, 1.0);
+	texCoord = aCorner;
+}
+)";
+
+// every program tints differently, so they really are different programs
+static std::string drawQueueBenchFragment(int program) {
+	return std::string(R"(#version 330 core
+in vec2 texCoord;
+out vec4 FragColor;
+uniform sampler2D spriteTexture;
+void main() {
+	FragColor = texture(spriteTexture, texCoord) * vec4()") + std::to_string((program % 4 + 1) / 4.0f) + ", 1.0, "
+		+ std::to_string((program / 4 + 1) / 2.0f) + R"(, 1.0);
+}
+)";
+}
+
+struct drawQueueBenchSprite {
+	int program;
+	int texture;
+	int vertexArray;
+	float x, y, size, depth;
+	GLint spriteLocation; // of `sprite` in the sprite's program
+};
+
+struct drawQueueBenchResult {
+	double cpuMs = 0.0; // submit + sort + issue, per frame
+	unsigned int glCalls = 0;
+	DrawQueue::Stats switches;
+};
+
+static unsigned int drawQueueBenchRandom(unsigned int& state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+static double drawQueueBenchMsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void drawQueueBenchSetup(const DrawCommand&, const void* user) {
+	const drawQueueBenchSprite* sprite = (const drawQueueBenchSprite*)user;
+	glUniform4f(sprite->spriteLocation, sprite->x, sprite->y, sprite->size, sprite->size);
+}
+
+static void drawQueueBenchPrint(const char* label, const drawQueueBenchResult& result) {
+	std::cout << "  " << label << ": " << result.switches.programSwitches << " program, " << result.switches.textureSwitches << " texture, "
+		<< result.switches.vertexArraySwitches << " vertex array switches, " << result.glCalls << " state calls issued, "
+		<< result.cpuMs << " ms CPU per frame" << std::endl;
+}
+
+int drawQueueBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(1024, 1024, "Draw Queue Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	std::vector<Shader> programs;
+	for (int i = 0; i < drawQueueBenchPROGRAMS; ++i) {
+		programs.emplace_back(ShaderSourceCode{ drawQueueBenchVertex, drawQueueBenchFragment(i) });
+	}
+
+	TextureParams params;
+	params.mipmaps = false;
+	std::vector<GLTexture> textures;
+	for (int i = 0; i < drawQueueBenchTEXTURES; ++i) {
+		unsigned char pixel[4] = { (unsigned char)(i * 73), (unsigned char)(i * 151), (unsigned char)(i * 29), 255 };
+		textures.push_back(uploadTexture2D(1, 1, 4, pixel, params));
+	}
+
+	// the same unit quad in every buffer, only the names differ
+	const float corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+	std::vector<GLVertexArray> vertexArrays;
+	std::vector<GLBuffer> buffers;
+	for (int i = 0; i < drawQueueBenchVERTEX_ARRAYS; ++i) {
+		vertexArrays.push_back(GLVertexArray::create());
+		glState().bindVertexArray(vertexArrays.back().id());
+		buffers.push_back(GLBuffer::create());
+		glState().bindBuffer(GL_ARRAY_BUFFER, buffers.back().id());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+	}
+
+	unsigned int random = 12345;
+	std::vector<drawQueueBenchSprite> sprites;
+	for (int i = 0; i < drawQueueBenchDRAWS; ++i) {
+		drawQueueBenchSprite sprite;
+		sprite.program = (int)(drawQueueBenchRandom(random) % drawQueueBenchPROGRAMS);
+		sprite.texture = (int)(drawQueueBenchRandom(random) % drawQueueBenchTEXTURES);
+		sprite.vertexArray = (int)(drawQueueBenchRandom(random) % drawQueueBenchVERTEX_ARRAYS);
+		sprite.size = 0.01f + (drawQueueBenchRandom(random) % 1000) / 50000.0f;
+		sprite.x = -1.0f + (drawQueueBenchRandom(random) % 2000) / 1000.0f;
+		sprite.y = -1.0f + (drawQueueBenchRandom(random) % 2000) / 1000.0f;
+		sprite.depth = (drawQueueBenchRandom(random) % 1000) / 1000.0f;
+		sprite.spriteLocation = programs[sprite.program].uniform("sprite").location;
+		sprites.push_back(sprite);
+	}
+	std::vector<DrawCommand> commands;
+	for (const drawQueueBenchSprite& sprite : sprites) {
+		DrawCommand command;
+		command.program = programs[sprite.program].ID;
+		command.vertexArray = vertexArrays[sprite.vertexArray].id();
+		command.setTexture(programs[sprite.program].samplerUnit("spriteTexture"), textures[sprite.texture].id());
+		command.count = 6;
+		command.setup = drawQueueBenchSetup;
+		command.user = &sprite;
+		commands.push_back(command);
+	}
+
+	drawQueueBenchResult inlined, unsorted, sorted;
+	DrawQueue queue;
+
+	// what a render loop without the queue does: bind everything for every draw
+	glState().endFrame();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < drawQueueBenchFRAMES; ++frame) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (const DrawCommand& command : commands) {
+			glUseProgram(command.program);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, command.textures[0]);
+			glBindVertexArray(command.vertexArray);
+			command.setup(command, command.user);
+			glDrawArrays(command.mode, 0, command.count);
+		}
+		glFinish();
+	}
+	inlined.cpuMs = drawQueueBenchMsSince(start) / drawQueueBenchFRAMES;
+	inlined.glCalls = 4 * drawQueueBenchDRAWS;
+	inlined.switches.draws = drawQueueBenchDRAWS;
+	inlined.switches.programSwitches = drawQueueBenchDRAWS;
+	inlined.switches.textureSwitches = drawQueueBenchDRAWS;
+	inlined.switches.vertexArraySwitches = drawQueueBenchDRAWS;
+	// nothing above went through the cache
+	glState().invalidate();
+
+	drawQueueBenchResult* results[2] = { &unsorted, &sorted };
+	for (int sort = 0; sort < 2; ++sort) {
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < drawQueueBenchFRAMES; ++frame) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			for (size_t i = 0; i < commands.size(); ++i) {
+				queue.submit(commands[i], sprites[i].depth);
+			}
+			if (sort) {
+				queue.sort();
+			}
+			queue.execute();
+			glState().endFrame();
+			glFinish();
+		}
+		results[sort]->cpuMs = drawQueueBenchMsSince(start) / drawQueueBenchFRAMES;
+		results[sort]->glCalls = glState().frameStats().issued;
+		results[sort]->switches = queue.getStats();
+	}
+	glState().bindVertexArray(0);
+
+	// the sort alone, radix against comparison sort on the same keys
+	std::vector<uint64_t> keys;
+	for (const DrawCommand& command : commands) {
+		keys.push_back(DrawKey::make(0, command.program, DrawKey::materialOf(command), command.vertexArray, sprites[keys.size()].depth));
+	}
+	double radixMs = 0.0, stdMs = 0.0;
+	for (int frame = 0; frame < drawQueueBenchFRAMES; ++frame) {
+		for (size_t i = 0; i < commands.size(); ++i) {
+			queue.submit(keys[i], commands[i]);
+		}
+		start = std::chrono::steady_clock::now();
+		queue.sort();
+		radixMs += drawQueueBenchMsSince(start);
+		std::vector<uint64_t> copy = keys;
+		start = std::chrono::steady_clock::now();
+		std::sort(copy.begin(), copy.end());
+		stdMs += drawQueueBenchMsSince(start);
+		queue.execute();
+		glFinish();
+	}
+
+	std::cout << drawQueueBenchDRAWS << " draws over " << drawQueueBenchPROGRAMS << " programs, " << drawQueueBenchTEXTURES << " textures and "
+		<< drawQueueBenchVERTEX_ARRAYS << " vertex arrays, mean of " << drawQueueBenchFRAMES << " frames" << std::endl;
+	drawQueueBenchPrint("inline", inlined);
+	drawQueueBenchPrint("queued, unsorted", unsorted);
+	drawQueueBenchPrint("queued, sorted", sorted);
+	std::cout << "  sorting " << drawQueueBenchDRAWS << " keys: radix " << radixMs / drawQueueBenchFRAMES << " ms, std::sort "
+		<< stdMs / drawQueueBenchFRAMES << " ms" << std::endl;
+	return 0;
+}
@@ -6,8 +6,8 @@ out vec4 FragColor;
 in vec3 ourColor; 
 in vec2 texCoord; 
 
-uniform vec4 ourColorA; // use a uniform to access values from cpp code 
-uniform float mixAmt; // Exercise 4
+// ourColorA, mixAmt (Exercise 4), ... arrive in one uniform buffer per frame
+#include "frameData.glsl"
 
 // why is sampler2D a uniform?
 // it corresponds to the `texture unit` which we use to label multiple textures
@@ -23,9 +23,14 @@ void main()
 	// Exercise 1
 	vec2 faceTexCoords = vec2(-texCoord.x, texCoord.y);
 
+#ifdef TEXTURE0_ONLY
+	// permutation built with TEXTURE0_ONLY defined, skips the second texture fetch entirely
+	FragColor = texture(texture0, texCoord);
+#else
 	// `mix` linearly interpolates color based on the final argument 
 	// 0.0 -> full texture0, 1.0 -> full texture1
 	FragColor = mix(texture(texture0, texCoord), texture(texture1, faceTexCoords), mixAmt);
+#endif
 	
 	//FragColor = ourColorA;
 };
@@ -0,0 +1,8 @@
+// per-frame values shared by every program, mirrored by FrameData in FrameData.h
+layout (std140) uniform FrameData {
+	vec4 ourColorA;
+	float xOffset;
+	float mixAmt;
+	float time;
+	float padding;
+};
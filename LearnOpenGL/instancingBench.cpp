@@ -0,0 +1,270 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./GLStateCache.h"
+#include "./InstancedMesh.h"
+#include "./StreamRing.h"
+#include "./Shader.h"
+#include "./Texture.h"
+#include "./TextureArray.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+
+// draws the same spinning, tinted quads once per quad (uniforms + glDrawElements each) and as
+// one instanced draw, reporting the CPU time to issue a frame and the whole frame time
+// every quad picks a layer of a texture array and mixes in a second texture by its own amount
+// the instanced draw runs twice, uploading through glBufferData/glBufferSubData and writing into
+// a StreamRing, the ring run doesn't wait for each frame to finish, so its fence waits show
+const int instancingBenchQUADS = 100000;
+const int instancingBenchLAYERS = 4;
+const int instancingBenchFRAMES = 30;
+
+// the per quad values come from uniforms, or with INSTANCED from the instance attributes
+static const char* instancingBenchVertex = R"(
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+#ifdef INSTANCED
+layout (location = 3) in mat4 aInstanceTransform;
+layout (location = 7) in vec4 aInstanceTint;
+layout (location = 8) in vec2 aInstanceParams;
+#else
+uniform mat4 instanceTransform;
+uniform vec4 instanceTint;
+uniform vec2 instanceParams;
+#define aInstanceTransform instanceTransform
+#define aInstanceTint instanceTint
+#define aInstanceParams instanceParams
+#endif
+out vec2 texCoord;
+out vec4 tint;
+flat out float layer;
+out float mixAmt;
+void main() {
+	gl_Position = aInstanceTransform * vec4(aPos, 1.0);
+	texCoord = aTexCoord;
+	tint = aInstanceTint;
+	layer = aInstanceParams.x;
+	mixAmt = aInstanceParams.y;
+}
+)";
+
+static const char* instancingBenchFragment = R"(#version 330 core
+in vec2 texCoord;
+in vec4 tint;
+flat in float layer;
+in float mixAmt;
+out vec4 FragColor;
+uniform sampler2DArray texture0;
+uniform sampler2D texture1;
+void main() {
+	FragColor = mix(texture(texture0, vec3(texCoord, layer)), texture(texture1, texCoord), mixAmt) * tint;
+}
+)";
+
+struct instancingBenchQuad {
+	float x, y, size, angle, spin;
+	float tint[4];
+	float layer, mixAmt;
+};
+
+static unsigned int instancingBenchRandom(unsigned int& state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+static double instancingBenchMsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 2D rotate + scale + translate as a column major mat4
+static void instancingBenchTransform(const instancingBenchQuad& quad, float time, float* transform) {
+	float angle = quad.angle + quad.spin * time;
+	float c = std::cos(angle) * quad.size, s = std::sin(angle) * quad.size;
+	const float columns[16] = { c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, quad.x, quad.y, 0.0f, 1.0f };
+	for (int i = 0; i < 16; ++i) {
+		transform[i] = columns[i];
+	}
+}
+
+// a checkerboard in a color of its own
+static std::vector<unsigned char> instancingBenchMakeImage(int size, unsigned int seed) {
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	unsigned char r = (unsigned char)(seed * 73), g = (unsigned char)(seed * 151), b = (unsigned char)(seed * 29);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			unsigned char* pixel = &pixels[((size_t)y * size + x) * 4];
+			bool dark = ((x / 8) + (y / 8)) % 2 == 0;
+			pixel[0] = dark ? r / 2 : r;
+			pixel[1] = dark ? g / 2 : g;
+			pixel[2] = dark ? b / 2 : b;
+			pixel[3] = 255;
+		}
+	}
+	return pixels;
+}
+
+static void instancingBenchBindTextures(const Shader& shader, const TextureArray& array, const GLTexture& overlay) {
+	glState().bindTexture((GLuint)shader.samplerUnit("texture0"), GL_TEXTURE_2D_ARRAY, array.texture.id());
+	glState().bindTexture((GLuint)shader.samplerUnit("texture1"), GL_TEXTURE_2D, overlay.id());
+}
+
+int instancingBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(1024, 1024, "Instancing Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	TextureParams params;
+	TextureArrayBuilder arrayBuilder;
+	for (int i = 0; i < instancingBenchLAYERS; ++i) {
+		arrayBuilder.add(std::to_string(i), instancingBenchMakeImage(64, (unsigned int)i + 1).data(), 64, 64, 4);
+	}
+	TextureArray array = arrayBuilder.build(params);
+	GLTexture overlay = uploadTexture2D(64, 64, 4, instancingBenchMakeImage(64, 99).data(), params);
+
+	// unit quad around the origin: x, y, z, u, v
+	const float vertices[] = {
+		-0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
+		0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f, 1.0f,
+		-0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+	};
+	const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+	// one vertex array per path, the instanced one gets the instance attributes added
+	GLBuffer vertexBuffer = GLBuffer::create();
+	GLBuffer indexBuffer = GLBuffer::create();
+	GLVertexArray vertexArrays[2] = { GLVertexArray::create(), GLVertexArray::create() };
+	for (GLVertexArray& vertexArray : vertexArrays) {
+		glState().bindVertexArray(vertexArray.id());
+		glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer.id());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.id());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+	}
+	InstancedMesh mesh(vertexArrays[1].id(), 6);
+
+	Shader singleShader(ShaderSourceCode{ std::string("#version 330 core\n") + instancingBenchVertex, instancingBenchFragment });
+	Shader instancedShader(ShaderSourceCode{ std::string("#version 330 core\n#define INSTANCED\n") + instancingBenchVertex, instancingBenchFragment });
+	UniformHandle transformUniform = singleShader.uniform("instanceTransform");
+	UniformHandle tintUniform = singleShader.uniform("instanceTint");
+	UniformHandle paramsUniform = singleShader.uniform("instanceParams");
+
+	unsigned int random = 12345;
+	std::vector<instancingBenchQuad> quads(instancingBenchQUADS);
+	for (instancingBenchQuad& quad : quads) {
+		quad.x = -1.0f + (instancingBenchRandom(random) % 2000) / 1000.0f;
+		quad.y = -1.0f + (instancingBenchRandom(random) % 2000) / 1000.0f;
+		quad.size = 0.005f + (instancingBenchRandom(random) % 1000) / 100000.0f;
+		quad.angle = (instancingBenchRandom(random) % 628) / 100.0f;
+		quad.spin = -1.0f + (instancingBenchRandom(random) % 2000) / 1000.0f;
+		for (float& channel : quad.tint) {
+			channel = 0.5f + (instancingBenchRandom(random) % 500) / 1000.0f;
+		}
+		quad.layer = (float)(instancingBenchRandom(random) % instancingBenchLAYERS);
+		quad.mixAmt = (instancingBenchRandom(random) % 1000) / 1000.0f;
+	}
+
+	// the transforms change every frame in both paths, so both pay for computing them
+	double singleCpuMs = 0.0, singleFrameMs = 0.0;
+	for (int frame = 0; frame < instancingBenchFRAMES; ++frame) {
+		float time = frame / 60.0f;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		singleShader.use();
+		instancingBenchBindTextures(singleShader, array, overlay);
+		glState().bindVertexArray(vertexArrays[0].id());
+		float transform[16];
+		for (const instancingBenchQuad& quad : quads) {
+			instancingBenchTransform(quad, time, transform);
+			glUniformMatrix4fv(transformUniform.location, 1, GL_FALSE, transform);
+			glUniform4fv(tintUniform.location, 1, quad.tint);
+			glUniform2f(paramsUniform.location, quad.layer, quad.mixAmt);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+		singleCpuMs += instancingBenchMsSince(start);
+		glFinish();
+		singleFrameMs += instancingBenchMsSince(start);
+	}
+
+	double instancedCpuMs = 0.0, instancedFrameMs = 0.0;
+	std::vector<InstanceData> instances(quads.size());
+	for (int frame = 0; frame < instancingBenchFRAMES; ++frame) {
+		float time = frame / 60.0f;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (size_t i = 0; i < quads.size(); ++i) {
+			instancingBenchTransform(quads[i], time, instances[i].transform);
+			for (int channel = 0; channel < 4; ++channel) {
+				instances[i].tint[channel] = quads[i].tint[channel];
+			}
+			instances[i].layer = quads[i].layer;
+			instances[i].mixAmt = quads[i].mixAmt;
+		}
+		mesh.setInstances(instances);
+		instancedShader.use();
+		instancingBenchBindTextures(instancedShader, array, overlay);
+		mesh.draw();
+		instancedCpuMs += instancingBenchMsSince(start);
+		glFinish();
+		instancedFrameMs += instancingBenchMsSince(start);
+	}
+
+	// pipelined like a real render loop, the ring's fences are all that hold the CPU back
+	StreamRing ring(instancingBenchQUADS * sizeof(InstanceData) + sizeof(InstanceData));
+	double ringCpuMs = 0.0, ringFenceWaitMs = 0.0;
+	std::chrono::steady_clock::time_point ringStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < instancingBenchFRAMES; ++frame) {
+		float time = frame / 60.0f;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ring.beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (size_t i = 0; i < quads.size(); ++i) {
+			instancingBenchTransform(quads[i], time, instances[i].transform);
+		}
+		mesh.setInstances(instances, ring);
+		instancedShader.use();
+		instancingBenchBindTextures(instancedShader, array, overlay);
+		mesh.draw();
+		ring.endFrame();
+		ringCpuMs += instancingBenchMsSince(start);
+		ringFenceWaitMs += ring.frameStats().fenceWaitMs;
+	}
+	glFinish();
+	double ringFrameMs = instancingBenchMsSince(ringStart);
+	glState().bindVertexArray(0);
+
+	std::cout << instancingBenchQUADS << " textured quads, mean of " << instancingBenchFRAMES << " frames" << std::endl;
+	std::cout << "  individual draws: " << instancingBenchQUADS << " draws, " << singleCpuMs / instancingBenchFRAMES << " ms CPU, "
+		<< singleFrameMs / instancingBenchFRAMES << " ms per frame" << std::endl;
+	std::cout << "  instanced: 1 draw, " << instancedCpuMs / instancingBenchFRAMES << " ms CPU, " << instancedFrameMs / instancingBenchFRAMES
+		<< " ms per frame (" << singleCpuMs / instancedCpuMs << "x less CPU, " << singleFrameMs / instancedFrameMs << "x faster)" << std::endl;
+	std::cout << "  instanced from a stream ring (" << (ring.persistent() ? "persistent" : "mapped copies") << ", pipelined): "
+		<< ringCpuMs / instancingBenchFRAMES << " ms CPU, " << ringFrameMs / instancingBenchFRAMES << " ms per frame, "
+		<< ring.frameStats().bytes << " bytes streamed and " << ringFenceWaitMs / instancingBenchFRAMES << " ms fence wait per frame" << std::endl;
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include "./MipGenerator.h"
+#include "stb_image.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+// builds the full mip chain of container.jpg (and an RGBA copy of it) over and over with
+// each MipGenerator path and reports source megapixels per second, no GL context needed
+const int mipBenchITERATIONS = 200;
+
+static double mipBenchRun(const std::vector<unsigned char>& pixels, int width, int height, int channels, bool srgb, MipPath path) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t levels = 0;
+	for (int i = 0; i < mipBenchITERATIONS; ++i) {
+		levels += MipGenerator::generate(pixels.data(), width, height, channels, srgb, path).size();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (levels == 0) {
+		return 0.0;
+	}
+	return (double)width * height * mipBenchITERATIONS / seconds / 1e6;
+}
+
+// every path has to produce exactly what the scalar one does
+static bool mipBenchMatches(const std::vector<unsigned char>& pixels, int width, int height, int channels, bool srgb, MipPath path) {
+	std::vector<MipLevel> reference = MipGenerator::generate(pixels.data(), width, height, channels, srgb, MipPath::Scalar);
+	std::vector<MipLevel> other = MipGenerator::generate(pixels.data(), width, height, channels, srgb, path);
+	if (reference.size() != other.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < reference.size(); ++i) {
+		if (reference[i].pixels != other[i].pixels) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void mipBenchReport(const char* label, const std::vector<unsigned char>& pixels, int width, int height, int channels, bool srgb) {
+	double scalar = mipBenchRun(pixels, width, height, channels, srgb, MipPath::Scalar);
+	double sse2 = mipBenchRun(pixels, width, height, channels, srgb, MipPath::SSE2);
+	std::cout << "  " << label << ": scalar " << scalar << " MPix/s, SSE2 " << sse2 << " MPix/s (x" << sse2 / scalar << ")";
+	if (MipGenerator::hasAVX2()) {
+		double avx2 = mipBenchRun(pixels, width, height, channels, srgb, MipPath::AVX2);
+		std::cout << ", AVX2 " << avx2 << " MPix/s (x" << avx2 / scalar << ")";
+	}
+	std::cout << std::endl;
+	if (!mipBenchMatches(pixels, width, height, channels, srgb, MipPath::SSE2) ||
+		(MipGenerator::hasAVX2() && !mipBenchMatches(pixels, width, height, channels, srgb, MipPath::AVX2))) {
+		std::cout << "ERROR::MIPBENCH::RESULTS_DIFFER " << label << std::endl;
+	}
+}
+
+int mipBenchMain() {
+	int width, height, channels;
+	unsigned char* decoded = stbi_load("container.jpg", &width, &height, &channels, 3);
+	if (!decoded) {
+		std::cout << "Failed to load container texture data" << std::endl;
+		return -1;
+	}
+	std::vector<unsigned char> rgb(decoded, decoded + (size_t)width * height * 3);
+	stbi_image_free(decoded);
+
+	std::vector<unsigned char> rgba((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; ++i) {
+		rgba[i * 4 + 0] = rgb[i * 3 + 0];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = 255;
+	}
+
+	std::cout << "mip chains of a " << width << "x" << height << " image, " << mipBenchITERATIONS << " times each" << std::endl;
+	mipBenchReport("RGB", rgb, width, height, 3, false);
+	mipBenchReport("RGBA", rgba, width, height, 4, false);
+	mipBenchReport("RGBA sRGB (table lookups, every path is scalar)", rgba, width, height, 4, true);
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./GLStateCache.h"
+#include "./InstancedMesh.h"
+#include "./MeshBatch.h"
+#include "./Shader.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+
+// draws the same objects (a mix of small meshes, each with its own transform and tint) once per
+// object with its own vertex array and uniforms, then through a MeshBatch on every path the
+// context supports, reporting draw calls, CPU time to issue a frame and the whole frame time
+const int multiDrawBenchMESHES = 8;
+const int multiDrawBenchOBJECTS = 20000;
+const int multiDrawBenchFRAMES = 30;
+
+// per object values from uniforms, or with INSTANCED from the batch's InstanceData
+static const char* multiDrawBenchVertex = R"(
+layout (location = 0) in vec3 aPos;
+#ifdef INSTANCED
+layout (location = 3) in mat4 aInstanceTransform;
+layout (location = 7) in vec4 aInstanceTint;
+#else
+uniform mat4 instanceTransform;
+uniform vec4 instanceTint;
+#define aInstanceTransform instanceTransform
+#define aInstanceTint instanceTint
+#endif
+out vec4 tint;
+void main() {
+	gl_Position = aInstanceTransform * vec4(aPos, 1.0);
+	tint = aInstanceTint;
+}
+)";
+
+static const char* multiDrawBenchFragment = R"(#version 330 core
+in vec4 tint;
+out vec4 FragColor;
+void main() {
+	FragColor = tint;
+}
+)";
+
+struct multiDrawBenchObject {
+	int mesh;
+	InstanceData instance;
+};
+
+struct multiDrawBenchResult {
+	unsigned int calls = 0; // per frame
+	double cpuMs = 0.0;
+	double frameMs = 0.0;
+};
+
+static unsigned int multiDrawBenchRandom(unsigned int& state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+static double multiDrawBenchMsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a regular polygon of `sides` sides around the origin, fanned from its center: x, y, z
+static void multiDrawBenchPolygon(int sides, std::vector<float>& vertices, std::vector<GLuint>& indices) {
+	vertices.assign({ 0.0f, 0.0f, 0.0f });
+	indices.clear();
+	for (int i = 0; i < sides; ++i) {
+		float angle = 6.2831853f * i / sides;
+		vertices.insert(vertices.end(), { 0.5f * std::cos(angle), 0.5f * std::sin(angle), 0.0f });
+		indices.insert(indices.end(), { 0u, (GLuint)(1 + i), (GLuint)(1 + (i + 1) % sides) });
+	}
+}
+
+static void multiDrawBenchPrint(const char* label, const multiDrawBenchResult& result, const multiDrawBenchResult& baseline) {
+	std::cout << "  " << label << ": " << result.calls << " draw calls, " << result.cpuMs << " ms CPU, " << result.frameMs << " ms per frame ("
+		<< baseline.cpuMs / result.cpuMs << "x less CPU, " << baseline.frameMs / result.frameMs << "x faster)" << std::endl;
+}
+
+int multiDrawBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(1024, 1024, "Multi Draw Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	// asking for 3.3 usually still gets the newest compatible context, so the newer paths can run
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	// every mesh on its own for the per object draws, and all of them in one batch
+	MeshBatch batch(3 * sizeof(float), { MeshAttribute{ 0, 3, 0 } });
+	std::vector<BatchedMesh> batched;
+	std::vector<GLVertexArray> vertexArrays;
+	std::vector<GLBuffer> buffers;
+	std::vector<GLsizei> indexCounts;
+	std::vector<float> vertices;
+	std::vector<GLuint> indices;
+	for (int i = 0; i < multiDrawBenchMESHES; ++i) {
+		multiDrawBenchPolygon(3 + i, vertices, indices);
+		batched.push_back(batch.addMesh(vertices.data(), vertices.size() / 3, indices.data(), indices.size()));
+		vertexArrays.push_back(GLVertexArray::create());
+		glState().bindVertexArray(vertexArrays.back().id());
+		buffers.push_back(GLBuffer::create());
+		glState().bindBuffer(GL_ARRAY_BUFFER, buffers.back().id());
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+		buffers.push_back(GLBuffer::create());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.back().id());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		indexCounts.push_back((GLsizei)indices.size());
+	}
+	batch.build();
+
+	Shader singleShader(ShaderSourceCode{ std::string("#version 330 core\n") + multiDrawBenchVertex, multiDrawBenchFragment });
+	Shader batchShader(ShaderSourceCode{ std::string("#version 330 core\n#define INSTANCED\n") + multiDrawBenchVertex, multiDrawBenchFragment });
+	UniformHandle transformUniform = singleShader.uniform("instanceTransform");
+	UniformHandle tintUniform = singleShader.uniform("instanceTint");
+
+	unsigned int random = 12345;
+	std::vector<multiDrawBenchObject> objects(multiDrawBenchOBJECTS);
+	for (multiDrawBenchObject& object : objects) {
+		object.mesh = (int)(multiDrawBenchRandom(random) % multiDrawBenchMESHES);
+		float size = 0.005f + (multiDrawBenchRandom(random) % 1000) / 50000.0f;
+		object.instance.transform[0] = size;
+		object.instance.transform[5] = size;
+		object.instance.transform[12] = -1.0f + (multiDrawBenchRandom(random) % 2000) / 1000.0f;
+		object.instance.transform[13] = -1.0f + (multiDrawBenchRandom(random) % 2000) / 1000.0f;
+		for (float& channel : object.instance.tint) {
+			channel = 0.25f + (multiDrawBenchRandom(random) % 750) / 1000.0f;
+		}
+	}
+
+	multiDrawBenchResult single;
+	for (int frame = 0; frame < multiDrawBenchFRAMES; ++frame) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		singleShader.use();
+		for (const multiDrawBenchObject& object : objects) {
+			glState().bindVertexArray(vertexArrays[object.mesh].id());
+			glUniformMatrix4fv(transformUniform.location, 1, GL_FALSE, object.instance.transform);
+			glUniform4fv(tintUniform.location, 1, object.instance.tint);
+			glDrawElements(GL_TRIANGLES, indexCounts[object.mesh], GL_UNSIGNED_INT, 0);
+		}
+		single.cpuMs += multiDrawBenchMsSince(start);
+		glFinish();
+		single.frameMs += multiDrawBenchMsSince(start);
+	}
+	single.calls = multiDrawBenchOBJECTS;
+	single.cpuMs /= multiDrawBenchFRAMES;
+	single.frameMs /= multiDrawBenchFRAMES;
+
+	std::cout << multiDrawBenchOBJECTS << " objects of " << multiDrawBenchMESHES << " meshes, mean of " << multiDrawBenchFRAMES << " frames" << std::endl;
+	std::cout << "  one draw per object: " << single.calls << " draw calls, " << single.cpuMs << " ms CPU, " << single.frameMs << " ms per frame" << std::endl;
+
+	const MeshBatch::Path paths[3] = { MeshBatch::Path::MultiDrawIndirect, MeshBatch::Path::BaseInstanceLoop, MeshBatch::Path::MultiDrawRuns };
+	const char* labels[3] = { "batched, multi draw indirect", "batched, base instance loop", "batched, 3.3 multi draw runs" };
+	for (int i = 0; i < 3; ++i) {
+		if (!batch.setPath(paths[i])) {
+			std::cout << "  " << labels[i] << ": not supported by this context" << std::endl;
+			continue;
+		}
+		multiDrawBenchResult result;
+		for (int frame = 0; frame < multiDrawBenchFRAMES; ++frame) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			glClear(GL_COLOR_BUFFER_BIT);
+			batchShader.use();
+			for (const multiDrawBenchObject& object : objects) {
+				batch.draw(batched[object.mesh], object.instance);
+			}
+			batch.flush();
+			result.cpuMs += multiDrawBenchMsSince(start);
+			glFinish();
+			result.frameMs += multiDrawBenchMsSince(start);
+		}
+		result.calls = batch.getStats().calls;
+		result.cpuMs /= multiDrawBenchFRAMES;
+		result.frameMs /= multiDrawBenchFRAMES;
+		multiDrawBenchPrint(labels[i], result, single);
+	}
+	glState().bindVertexArray(0);
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./Shader.h"
+#include "./ShaderBatch.h"
+
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// compiles N copies of our shaders once with ShaderBuild::Now (check status after every
+// step, one program at a time) and once through ShaderBatch (submit all, check at the end)
+const int benchPROGRAM_COUNT = 64;
+
+// every program gets a unique #define so neither our binary cache nor the driver's own
+// shader cache can hand back a program it already compiled, the preprocessor puts it after #version
+static std::string benchReadVariant(const char* path, const std::string& salt) {
+	std::shared_ptr<const ExpandedShaderSource> source = ShaderPreprocessor::instance().expand(path, ShaderDefines().add("BENCH_VARIANT_" + salt));
+	return source ? source->code : std::string();
+}
+
+// a timing of programs that failed to build would only measure the compiler bailing out
+static bool benchAllLinked(const std::vector<Shader*>& shaders, const char* label) {
+	for (Shader* shader : shaders) {
+		GLint linked = GL_FALSE;
+		if (shader->ID != 0) {
+			glGetProgramiv(shader->ID, GL_LINK_STATUS, &linked);
+		}
+		if (!linked) {
+			std::cout << "ERROR::SHADER_BENCH::LINK_FAILED " << label << " program " << shader->ID << ", timings would be meaningless" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int shaderBenchMain() {
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // only need the context
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Shader Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+	ProgramBinaryCache::instance().setEnabled(false);
+
+	std::string runSalt = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	std::vector<ShaderSourceCode> serialSources, batchSources;
+	for (int i = 0; i < benchPROGRAM_COUNT; ++i) {
+		std::string salt = runSalt + "_" + std::to_string(i);
+		serialSources.push_back({ benchReadVariant("./vertexShader.glsl", "S" + salt), benchReadVariant("./fragmentShader.glsl", "S" + salt) });
+		batchSources.push_back({ benchReadVariant("./vertexShader.glsl", "B" + salt), benchReadVariant("./fragmentShader.glsl", "B" + salt) });
+	}
+
+	// scoped so every program is deleted while the context still exists
+	bool linked = true;
+	{
+		// one at a time, stalling on every status query
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<std::unique_ptr<Shader>> serial;
+		for (const ShaderSourceCode& source : serialSources) {
+			serial.push_back(std::unique_ptr<Shader>(new Shader(source, ShaderBuild::Now)));
+		}
+		glFinish();
+		double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// everything submitted up front, statuses checked once at the end
+		start = std::chrono::steady_clock::now();
+		ShaderBatch batch;
+		for (const ShaderSourceCode& source : batchSources) {
+			batch.add(source);
+		}
+		double submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		batch.finish();
+		glFinish();
+		double batchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<Shader*> serialShaders, batchShaders;
+		for (std::unique_ptr<Shader>& shader : serial) {
+			serialShaders.push_back(shader.get());
+		}
+		for (size_t i = 0; i < batch.size(); ++i) {
+			batchShaders.push_back(&batch[i]);
+		}
+		linked = benchAllLinked(serialShaders, "serial") && benchAllLinked(batchShaders, "batched");
+		if (linked) {
+			std::cout << "compiled " << benchPROGRAM_COUNT << " programs" << std::endl;
+			std::cout << "  KHR_parallel_shader_compile: " << (glExt().parallelShaderCompile ? "yes" : "no") << std::endl;
+			std::cout << "  serial:  " << serialMs << " ms" << std::endl;
+			std::cout << "  batched: " << batchMs << " ms (" << submitMs << " ms to submit)" << std::endl;
+		}
+	}
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return linked ? 0 : -1;
+}
@@ -1,6 +1,12 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "./Shader.h"
+#include "./ShaderWatcher.h"
+#include "./FrameData.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./GLFWSession.h"
+#include "./DrawQueue.h"
 
 #include <iostream>
 #include <cmath>
@@ -27,8 +33,8 @@ int __main() {
 		0.5f, -0.5f, 0.0f,  1.0f, 1.0f, 0.0f,
 	};
 
-	// initialize glfw
-	glfwInit();
+	// initialize glfw, terminated when __main returns (after every GL object below is gone)
+	GLFWSession glfw;
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // these tell glfw we are using 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // version 3.3 of OpenGL
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -37,7 +43,6 @@ int __main() {
 	GLFWwindow* window = glfwCreateWindow(__SCR_WIDTH, __SCR_HEIGHT, "Hello Window", NULL, NULL);
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
@@ -48,14 +53,14 @@ int __main() {
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	// pick up the post-3.3 entry points we can use (program binaries, ...)
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+	GLVertexArray VAO = GLVertexArray::create();
+	glState().bindVertexArray(VAO.id());
 
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLBuffer VBO = GLBuffer::create();
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO.id());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
 
 	// position pointer
@@ -100,13 +105,20 @@ int __main() {
 	glLinkProgram(shaderProgram);
 	*/
 	Shader ourShader("./vertexShader.glsl", "./fragmentShader.glsl");
+	ProgramBinaryCache::instance().printStats();
+	// edits to the .glsl files get recompiled and swapped in while we keep running
+	ShaderWatcher shaderWatcher(window); // compiles on a context shared with this window
+	shaderWatcher.watch(ourShader);
+	// ourColorA and xOffset live in the FrameData uniform block now
+	UniformBuffer<FrameData> frameUniforms("FrameData");
+	DrawQueue drawQueue;
 
 	while (!glfwWindowShouldClose(window)) {
 		glClearColor(0.5f, 0.5f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		//glUseProgram(shaderProgram);
-		ourShader.use();
+		ourShader.finish(); // the draw queue binds the program, a deferred build has to be checked first
 
 		// updating uniform value
 		float timeValue = glfwGetTime();
@@ -114,30 +126,36 @@ int __main() {
 		float blueValue = (cos(timeValue) / 2.0 + 0.5);
 		//int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor"); // "find" the uniform in our shader
 		//glUniform4f(vertexColorLocation, 0.0f, greenValue, blueValue, 1.0f); // set the value of the uniform vec4 of floats
-		ourShader.setColor("ourColorA", 0.0f, greenValue, blueValue, 1.0f);
+		FrameData frame = {};
+		frame.ourColorA = { 0.0f, greenValue, blueValue, 1.0f };
 
 		// Exercise 2 of Shaders chapter
-		ourShader.setFloat("xOffset", sin(timeValue));
-
-		// rendering the triangle
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
-		glBindVertexArray(0);
+		frame.xOffset = sin(timeValue);
+		frame.time = timeValue;
+		frameUniforms.update(frame);
+
+		// rendering the triangle, left bound, the cache skips the binds after the first frame
+		DrawCommand triangleDraw;
+		triangleDraw.program = ourShader.ID;
+		triangleDraw.vertexArray = VAO.id();
+		triangleDraw.count = 3;
+		drawQueue.submit(triangleDraw);
+		drawQueue.flush();
+		glState().endFrame();
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		shaderWatcher.update();
 	}
 
-	// deallocate resources
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	//glDeleteProgram(shaderProgram);
-	glDeleteProgram(ourShader.ID);
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	glState().printStats();
+
+	// resources (VAO, VBO, shader) are released by their destructors,
+	// then GLFWSession terminates glfw
+	return 0;
 }
 
 // callback function to handle resizing of the window
 void __framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	glState().viewport(0, 0, width, height);
 }
@@ -0,0 +1,271 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./Shader.h"
+#include "./Texture.h"
+#include "./TextureAtlas.h"
+#include "./TextureArray.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// draws the same sprites three ways and reports draw calls, texture binds and frame time:
+// one texture per image (bind + draw per sprite), everything in a skyline packed atlas and
+// everything in the layers of a texture array (one bind, one draw for all of them)
+// the images are generated, mixed sizes for the atlas and 64x64 for the array
+const int atlasBenchIMAGE_COUNT = 128;
+const int atlasBenchSPRITE_COUNT = 10000;
+const int atlasBenchFRAMES = 100;
+
+// per sprite offset/scale and uv rect as uniforms, the corners come from a unit quad
+static const char* atlasBenchSingleVertex = R"(#version 330 core
+layout (location = 0) in vec2 aCorner;
+uniform vec4 sprite; // xy offset, zw size
+uniform vec4 uvRect; // xy min, zw max
+out vec2 texCoord;
+void main() {
+	gl_Position = vec4(sprite.xy + aCorner * sprite.zw, 0.0, 1.0);
+	texCoord = mix(uvRect.xy, uvRect.zw, aCorner);
+}
+)";
+
+// every sprite's vertices already in the buffer
+static const char* atlasBenchBatchedVertex = R"(#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec3 aTexCoord; // z is the array layer
+out vec2 texCoord;
+out float layer;
+void main() {
+	gl_Position = vec4(aPos, 0.0, 1.0);
+	texCoord = aTexCoord.xy;
+	layer = aTexCoord.z;
+}
+)";
+
+static const char* atlasBenchTextureFragment = R"(#version 330 core
+in vec2 texCoord;
+out vec4 FragColor;
+uniform sampler2D spriteTexture;
+void main() {
+	FragColor = texture(spriteTexture, texCoord);
+}
+)";
+
+static const char* atlasBenchArrayFragment = R"(#version 330 core
+in vec2 texCoord;
+in float layer;
+out vec4 FragColor;
+uniform sampler2DArray spriteTexture;
+void main() {
+	FragColor = texture(spriteTexture, vec3(texCoord, layer));
+}
+)";
+
+struct atlasBenchSprite {
+	int image;
+	float x, y, size;
+};
+
+struct atlasBenchResult {
+	unsigned int draws = 0; // per frame
+	unsigned int binds = 0;
+	double frameMs = 0.0;
+};
+
+static unsigned int atlasBenchRandom(unsigned int& state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// a checkerboard in a color of its own, so mixed up UVs would show
+static std::vector<unsigned char> atlasBenchMakeImage(int width, int height, unsigned int seed) {
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	unsigned char r = (unsigned char)(seed * 73), g = (unsigned char)(seed * 151), b = (unsigned char)(seed * 29);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			unsigned char* pixel = &pixels[((size_t)y * width + x) * 4];
+			bool dark = ((x / 8) + (y / 8)) % 2 == 0;
+			pixel[0] = dark ? r / 2 : r;
+			pixel[1] = dark ? g / 2 : g;
+			pixel[2] = dark ? b / 2 : b;
+			pixel[3] = 255;
+		}
+	}
+	return pixels;
+}
+
+// two triangles per sprite: x, y, u, v, layer
+static void atlasBenchAppendQuad(std::vector<float>& vertices, const atlasBenchSprite& sprite, float u0, float v0, float u1, float v1, float layer) {
+	float x0 = sprite.x, y0 = sprite.y, x1 = sprite.x + sprite.size, y1 = sprite.y + sprite.size;
+	const float quad[6][5] = {
+		{ x0, y0, u0, v0, layer }, { x1, y0, u1, v0, layer }, { x1, y1, u1, v1, layer },
+		{ x0, y0, u0, v0, layer }, { x1, y1, u1, v1, layer }, { x0, y1, u0, v1, layer },
+	};
+	vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 30);
+}
+
+static double atlasBenchMsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static GLVertexArray atlasBenchBatchedVertexArray(const std::vector<float>& vertices, GLBuffer& buffer) {
+	GLVertexArray vao = GLVertexArray::create();
+	glBindVertexArray(vao.id());
+	buffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.id());
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+	return vao;
+}
+
+static void atlasBenchPrint(const char* label, const atlasBenchResult& result, const atlasBenchResult& baseline) {
+	std::cout << "  " << label << ": " << result.draws << " draws, " << result.binds << " binds, " << result.frameMs << " ms per frame ("
+		<< (double)baseline.draws / result.draws << "x fewer draws, " << baseline.frameMs / result.frameMs << "x faster)" << std::endl;
+}
+
+int textureAtlasBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(1024, 1024, "Texture Atlas Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	TextureParams params;
+	params.wrapS = GL_CLAMP_TO_EDGE;
+	params.wrapT = GL_CLAMP_TO_EDGE;
+
+	// the same images as separate textures and in an atlas, 64x64 versions in an array
+	unsigned int random = 12345;
+	std::vector<GLTexture> separate;
+	TextureAtlasBuilder atlasBuilder;
+	TextureArrayBuilder arrayBuilder;
+	for (int i = 0; i < atlasBenchIMAGE_COUNT; ++i) {
+		int width = 16 + (int)(atlasBenchRandom(random) % 113);
+		int height = 16 + (int)(atlasBenchRandom(random) % 113);
+		std::vector<unsigned char> pixels = atlasBenchMakeImage(width, height, (unsigned int)i + 1);
+		separate.push_back(uploadTexture2D(width, height, 4, pixels.data(), params));
+		atlasBuilder.add(std::to_string(i), pixels.data(), width, height, 4);
+		arrayBuilder.add(std::to_string(i), atlasBenchMakeImage(64, 64, (unsigned int)i + 1).data(), 64, 64, 4);
+	}
+	TextureAtlas atlas = atlasBuilder.build(params);
+	TextureArray array = arrayBuilder.build(params);
+
+	std::vector<atlasBenchSprite> sprites;
+	for (int i = 0; i < atlasBenchSPRITE_COUNT; ++i) {
+		atlasBenchSprite sprite;
+		sprite.image = i % atlasBenchIMAGE_COUNT;
+		sprite.size = 0.02f + (atlasBenchRandom(random) % 1000) / 25000.0f;
+		sprite.x = -1.0f + (atlasBenchRandom(random) % 2000) / 1000.0f - sprite.size / 2;
+		sprite.y = -1.0f + (atlasBenchRandom(random) % 2000) / 1000.0f - sprite.size / 2;
+		sprites.push_back(sprite);
+	}
+
+	// built once, the sprites don't move
+	std::vector<float> atlasVertices, arrayVertices;
+	for (const atlasBenchSprite& sprite : sprites) {
+		const AtlasRegion* region = atlas.find(std::to_string(sprite.image));
+		if (region) {
+			atlasBenchAppendQuad(atlasVertices, sprite, region->u0, region->v0, region->u1, region->v1, 0.0f);
+		}
+		atlasBenchAppendQuad(arrayVertices, sprite, 0.0f, 0.0f, 1.0f, 1.0f, (float)array.layer(std::to_string(sprite.image)));
+	}
+	GLBuffer atlasBuffer, arrayBuffer;
+	GLVertexArray atlasVAO = atlasBenchBatchedVertexArray(atlasVertices, atlasBuffer);
+	GLVertexArray arrayVAO = atlasBenchBatchedVertexArray(arrayVertices, arrayBuffer);
+
+	const float corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+	GLVertexArray quadVAO = GLVertexArray::create();
+	glBindVertexArray(quadVAO.id());
+	GLBuffer quadBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, quadBuffer.id());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+
+	Shader singleShader(ShaderSourceCode{ atlasBenchSingleVertex, atlasBenchTextureFragment });
+	Shader atlasShader(ShaderSourceCode{ atlasBenchBatchedVertex, atlasBenchTextureFragment });
+	Shader arrayShader(ShaderSourceCode{ atlasBenchBatchedVertex, atlasBenchArrayFragment });
+	UniformHandle spriteUniform = singleShader.uniform("sprite");
+	UniformHandle uvRectUniform = singleShader.uniform("uvRect");
+
+	atlasBenchResult single, atlased, arrayed;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < atlasBenchFRAMES; ++frame) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		singleShader.use();
+		glActiveTexture(GL_TEXTURE0 + singleShader.samplerUnit("spriteTexture"));
+		glBindVertexArray(quadVAO.id());
+		single = atlasBenchResult();
+		for (const atlasBenchSprite& sprite : sprites) {
+			glBindTexture(GL_TEXTURE_2D, separate[sprite.image].id());
+			singleShader.setVec4(spriteUniform, sprite.x, sprite.y, sprite.size, sprite.size);
+			singleShader.setVec4(uvRectUniform, 0.0f, 0.0f, 1.0f, 1.0f);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			single.binds++;
+			single.draws++;
+		}
+		glFinish();
+	}
+	single.frameMs = atlasBenchMsSince(start) / atlasBenchFRAMES;
+
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < atlasBenchFRAMES; ++frame) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		atlasShader.use();
+		glActiveTexture(GL_TEXTURE0 + atlasShader.samplerUnit("spriteTexture"));
+		glBindTexture(GL_TEXTURE_2D, atlas.texture.id());
+		glBindVertexArray(atlasVAO.id());
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(atlasVertices.size() / 5));
+		glFinish();
+	}
+	atlased.frameMs = atlasBenchMsSince(start) / atlasBenchFRAMES;
+	atlased.draws = 1;
+	atlased.binds = 1;
+
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < atlasBenchFRAMES; ++frame) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		arrayShader.use();
+		glActiveTexture(GL_TEXTURE0 + arrayShader.samplerUnit("spriteTexture"));
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture.id());
+		glBindVertexArray(arrayVAO.id());
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(arrayVertices.size() / 5));
+		glFinish();
+	}
+	arrayed.frameMs = atlasBenchMsSince(start) / atlasBenchFRAMES;
+	arrayed.draws = 1;
+	arrayed.binds = 1;
+	glBindVertexArray(0);
+
+	std::cout << atlas.stats.images << " images packed into a " << atlas.width << "x" << atlas.height << " atlas, "
+		<< atlas.stats.efficiency() * 100.0 << "% of it image (" << atlas.stats.rejected << " didn't fit)" << std::endl;
+	std::cout << array.layers << " layers of " << array.width << "x" << array.height << " in the array" << std::endl;
+	std::cout << atlasBenchSPRITE_COUNT << " sprites, mean of " << atlasBenchFRAMES << " frames" << std::endl;
+	std::cout << "  separate textures: " << single.draws << " draws, " << single.binds << " binds, " << single.frameMs << " ms per frame" << std::endl;
+	atlasBenchPrint("atlas", atlased, single);
+	atlasBenchPrint("texture array", arrayed, single);
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "./Texture.h"
+#include "./MipGenerator.h"
+#include "./BlockCompressor.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// block compresses the demo textures (base level and mips) on one thread and on every core,
+// and reports encode throughput and how much memory the compressed chain saves
+// CPU only, no GL context needed
+const int compressBenchITERATIONS = 20;
+
+static double compressBenchMPixPerSecond(const TextureImage& image, unsigned int threads, CompressedImage& result) {
+	double totalMs = 0.0;
+	for (int i = 0; i < compressBenchITERATIONS; ++i) {
+		result = BlockCompressor::compress(image.pixels.get(), image.width, image.height, image.channels, image.mips, threads);
+		totalMs += result.encodeMs;
+	}
+	size_t pixels = (size_t)image.width * image.height;
+	for (const MipLevel& level : image.mips) {
+		pixels += (size_t)level.width * level.height;
+	}
+	return (double)pixels * compressBenchITERATIONS / (totalMs / 1000.0) / 1e6;
+}
+
+int textureCompressBenchMain() {
+	const char* files[] = { "container.jpg", "awesomeface.png" };
+	unsigned int cores = std::thread::hardware_concurrency();
+	cores = cores > 0 ? cores : 1;
+
+	std::cout << "block compression, " << compressBenchITERATIONS << " runs per texture, mip chains included" << std::endl;
+	for (const char* file : files) {
+		TextureImage image = TextureImage::decode(file, true);
+		if (!image) {
+			std::cout << "Failed to load " << file << ": " << image.error << std::endl;
+			continue;
+		}
+		image.generateMips(false);
+
+		CompressedImage compressed;
+		double single = compressBenchMPixPerSecond(image, 1, compressed);
+		double all = compressBenchMPixPerSecond(image, cores, compressed);
+		size_t before = compressed.uncompressedBytes(), after = compressed.compressedBytes();
+		std::cout << "  " << file << " (" << image.width << "x" << image.height << ", " << image.channels << " channels) -> "
+			<< (compressed.format == BlockFormat::BC1 ? "BC1" : "BC3") << ": "
+			<< single << " MPix/s on 1 thread, " << all << " MPix/s on " << cores << ", "
+			<< before / 1024 << " KB -> " << after / 1024 << " KB (" << (before - after) / 1024 << " KB saved, "
+			<< (double)before / after << ":1)" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "./GLExtensions.h"
+#include "./GLObjects.h"
+#include "./GLFWSession.h"
+#include "./TextureLoader.h"
+#include "./PixelUploadRing.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// streams the same set of textures twice while rendering frames as fast as possible,
+// once uploading from client memory and once through a PixelUploadRing, and reports how
+// long the frames took while the uploads were going on
+const int streamBenchTEXTURE_COUNT = 128;
+const double streamBenchUPLOAD_BUDGET_MS = 2.0;
+
+struct streamBenchResult {
+	size_t frames = 0;
+	double totalMs = 0.0;
+	double meanFrameMs = 0.0;
+	double p99FrameMs = 0.0;
+	double worstFrameMs = 0.0;
+};
+
+static streamBenchResult streamBenchRun(GLFWwindow* window, PixelUploadRing* staging) {
+	const char* files[] = { "container.jpg", "awesomeface.png" };
+	std::vector<GLTexture> textures;
+	std::vector<double> frameMs;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		TextureLoader loader(0, staging);
+		TextureParams params;
+		for (int i = 0; i < streamBenchTEXTURE_COUNT; ++i) {
+			loader.load(files[i % 2], params, [&textures](GLTexture texture, const TextureImage&) {
+				textures.push_back(std::move(texture));
+			});
+		}
+
+		while (loader.outstanding() > 0 && !glfwWindowShouldClose(window)) {
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			loader.pump(streamBenchUPLOAD_BUDGET_MS);
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+			frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+		}
+	}
+	glFinish();
+
+	streamBenchResult result;
+	result.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.frames = frameMs.size();
+	if (!frameMs.empty()) {
+		std::sort(frameMs.begin(), frameMs.end());
+		double sum = 0.0;
+		for (double ms : frameMs) {
+			sum += ms;
+		}
+		result.meanFrameMs = sum / frameMs.size();
+		result.p99FrameMs = frameMs[(frameMs.size() * 99) / 100];
+		result.worstFrameMs = frameMs.back();
+	}
+	return result;
+}
+
+static void streamBenchPrint(const char* label, const streamBenchResult& result) {
+	std::cout << "  " << label << ": " << result.totalMs << " ms over " << result.frames << " frames, frame mean "
+		<< result.meanFrameMs << " ms, p99 " << result.p99FrameMs << " ms, worst " << result.worstFrameMs << " ms" << std::endl;
+}
+
+int textureStreamBenchMain() {
+
+	GLFWSession glfw;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(640, 360, "Texture Stream Bench", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0); // vsync would hide the spikes
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+	// warm the OS file cache so neither run pays for the first read from disk
+	streamBenchRun(window, nullptr);
+
+	streamBenchResult direct = streamBenchRun(window, nullptr);
+	streamBenchResult staged;
+	bool persistent = false;
+	{
+		PixelUploadRing staging;
+		persistent = staging.persistent();
+		staged = streamBenchRun(window, &staging);
+	}
+
+	std::cout << "streamed " << streamBenchTEXTURE_COUNT << " textures, " << streamBenchUPLOAD_BUDGET_MS << " ms upload budget per frame" << std::endl;
+	streamBenchPrint("client memory", direct);
+	streamBenchPrint(persistent ? "PBO ring (persistent)" : "PBO ring (mapped per use)", staged);
+	return 0;
+}
@@ -1,10 +1,21 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "./Shader.h"
-#include "stb_image.h"
+#include "./ShaderWatcher.h"
+#include "./FrameData.h"
+#include "./GLObjects.h"
+#include "./GLStateCache.h"
+#include "./GLFWSession.h"
+#include "./TextureLoader.h"
+#include "./TextureManager.h"
+#include "./CookedTexture.h"
+#include "./DrawQueue.h"
+#include "./StreamRing.h"
 
 #include <iostream>
+#include <algorithm>
 #include <cmath>
+#include <string>
 
 void texFramebuffer_size_callback(GLFWwindow* window, int width, int height);
 void texProcessInput(GLFWwindow* window);
@@ -37,8 +48,8 @@ int texMain() {
 		0, 2, 3, // second triangle
 	};
 
-	// initialize glfw
-	glfwInit();
+	// initialize glfw, terminated when texMain returns (after every GL object below is gone)
+	GLFWSession glfw;
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // these tell glfw we are using 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // version 3.3 of OpenGL
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -47,7 +58,6 @@ int texMain() {
 	GLFWwindow* window = glfwCreateWindow(texSCR_WIDTH, tesSCR_HEIGHT, "Hello Window", NULL, NULL);
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
@@ -58,70 +68,55 @@ int texMain() {
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	// pick up the post-3.3 entry points we can use (program binaries, ...)
+	loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
 	// create textures!
-	unsigned int textures[2]; // reference IDs
-	glGenTextures(2, textures);
-
-	glActiveTexture(GL_TEXTURE0); // activate texture unit (optional if only using 1 texture)
-	glBindTexture(GL_TEXTURE_2D, textures[0]);
-
-	// set behavior of textures when coordinates extend beyond (0,0) to (1,1)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // horizontal direction
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // vertical direction
-	// specifying texture filtering 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // when scaling down
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // when scaling up
-
-	stbi_set_flip_vertically_on_load(true); // due to differences in image vs OpenGL coordinates
-	// load in container texture
-	int width, height, nrChannels;
-	unsigned char* containerData = stbi_load("container.jpg", &width, &height, &nrChannels, 0);
-	if (!containerData) {
-		std::cout << "Failed to load container texture data" << std::endl;
-		return -1;
-	}
-
-	// generate texture and mipmap from loaded image
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, containerData);
+	// both images decode in parallel on the loader's worker threads and get uploaded by
+	// pump() in the render loop, we draw with a placeholder until then
+	TextureLoader textureLoader;
+	// asking for the same image again (any path, same params) shares the first texture
+	TextureManager textureManager(textureLoader);
+	// past this, textures that haven't been drawn for a while lose their top mips (or get evicted)
+	textureManager.setBudget(64 * 1024 * 1024);
+
+	// behavior of textures when coordinates extend beyond (0,0) to (1,1) and how they're filtered
+	TextureParams textureParams;
+	textureParams.wrapS = GL_REPEAT; // horizontal direction
+	textureParams.wrapT = GL_REPEAT; // vertical direction
+	textureParams.minFilter = GL_NEAREST; // when scaling down
+	textureParams.magFilter = GL_NEAREST; // when scaling up
 	// mipmaps are collections of the same texture at different size
 	// this lets OpenGL use the smaller version of the same texture when an object is further away
 	// switching between mipmaps can cause artifacts - different filtering methods just like normal textures
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	// good practice to free image memory after this
-	stbi_image_free(containerData);
-
-	// load in face texture
-	unsigned char* faceData = stbi_load("awesomeface.png", &width, &height, &nrChannels, 0);
-	if (!faceData) {
-		std::cout << "Failed to load face texture data" << std::endl;
-		return -1;
-	}
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, textures[1]);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // horizontal direction
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // vertical direction
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // when scaling down
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // when scaling up
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, faceData);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(faceData);
-
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	textureParams.mipmaps = true;
+	textureParams.cpuMipmaps = true; // built by the loader's worker threads, uploaded with the base level
+	textureParams.compress = true; // BC1 for the container, BC3 for the face, if the driver has S3TC
+	textureParams.flipVertically = true; // due to differences in image vs OpenGL coordinates
+	// stored as GL_RGB8/GL_RGBA8, GL_SRGB8(_ALPHA8) would need an sRGB framebuffer to look the same
+	textureParams.srgb = false;
+
+	// the first run cooks both images into ./texture_cache with everything above baked in,
+	// later runs map the cooked files and upload them without decoding anything
+	// (cooked without compression if the driver can't sample S3TC, the cook step can't ask it)
+	TextureParams cookParams = textureParams;
+	cookParams.compress = textureParams.compress && canUploadCompressed(textureParams);
+	std::string containerPath = cookTextureIfStale("container.jpg", cookParams);
+	std::string facePath = cookTextureIfStale("awesomeface.png", cookParams);
+
+	// load in container and face textures, the mapped files are closed after the upload
+	TextureHandle containerTexture = textureManager.acquire(containerPath, textureParams); // deleted with the last handle
+	TextureHandle faceTexture = textureManager.acquire(facePath, textureParams);
+
+	GLVertexArray VAO = GLVertexArray::create();
+	glState().bindVertexArray(VAO.id());
+
+	GLBuffer VBO = GLBuffer::create();
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO.id());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-	unsigned int EBO;
-	glGenBuffers(1, &EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	GLBuffer EBO = GLBuffer::create();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.id());
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
 	// position pointer
@@ -135,43 +130,77 @@ int texMain() {
 	glEnableVertexAttribArray(2);
 
 	Shader ourShader("./vertexShader.glsl", "./fragmentShader.glsl");
+	// same files specialized at compile time, used while the face is fully mixed out
+	Shader containerShader("./vertexShader.glsl", "./fragmentShader.glsl", ShaderDefines().add("TEXTURE0_ONLY"));
+	ProgramBinaryCache::instance().printStats();
+	// checked once here instead of trusting the layout on every draw
+	ourShader.reflection().validateVertexArray(VAO.id(), "textures VAO");
+	// sampler units were assigned when the programs linked (texture0 -> 0, texture1 -> 1),
+	// both permutations agree since the units follow the sampler names
+	const int containerUnit = ourShader.samplerUnit("texture0");
+	const int faceUnit = ourShader.samplerUnit("texture1");
+	// edits to the .glsl files get recompiled and swapped in while we keep running
+	ShaderWatcher shaderWatcher(window); // compiles on a context shared with this window
+	shaderWatcher.watch(ourShader);
+	shaderWatcher.watch(containerShader);
+	// per-frame values shared by both programs, one buffer update instead of a glUniform* per value
+	UniformBuffer<FrameData> frameUniforms("FrameData");
+	// this frame's copy of the block goes into a ring the GPU reads from directly, the two
+	// frames before can still be in flight
+	StreamRing streamRing(64 * 1024);
+	DrawQueue drawQueue;
 
 	while (!glfwWindowShouldClose(window)) {
 		texProcessInput(window);
+		// swap in whatever finished decoding, without spending more than ~2ms of the frame on it
+		textureLoader.pump(2.0);
+		streamRing.beginFrame();
 		glClearColor(1.0f, 0.65f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		//glUseProgram(shaderProgram);
-		ourShader.use();
-		ourShader.setInt("texture0", 0);
-		ourShader.setInt("texture1", 1);
-
-		ourShader.setFloat("mixAmt", MIX_AMT);
-
-		// rendering the triangle
-		glBindTexture(GL_TEXTURE_2D, textures[0]);
-		glBindTexture(GL_TEXTURE_2D, textures[1]);
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		FrameData frame = {};
+		frame.mixAmt = MIX_AMT;
+		frame.time = (float)glfwGetTime();
+		frameUniforms.update(frame, streamRing);
+
+		Shader& activeShader = MIX_AMT > 0.0f ? ourShader : containerShader;
+		activeShader.finish(); // the queue binds the program itself, a deferred build has to be checked first
+
+		// rendering the quad, the queue sorts the frame's draws by state and leaves it bound,
+		// from the second frame on the cache skips every bind
+		DrawCommand quad;
+		quad.program = activeShader.ID;
+		quad.setTexture(containerUnit, containerTexture.touch());
+		quad.setTexture(faceUnit, faceTexture.touch());
+		quad.vertexArray = VAO.id();
+		quad.indexType = GL_UNSIGNED_INT;
+		quad.count = 6;
+		drawQueue.submit(quad);
+		drawQueue.flush();
+		streamRing.endFrame();
+		// after the last texture of the frame was touched, anything used is safe from the budget
+		textureManager.endFrame();
+		glState().endFrame();
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		shaderWatcher.update();
 	}
 
-	// deallocate resources
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-	glDeleteProgram(ourShader.ID);
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	textureManager.printStats();
+	drawQueue.printStats();
+	glState().printStats();
+	streamRing.printStats();
+
+	// resources (textures, buffers, VAO, shaders) are released by their destructors,
+	// then GLFWSession terminates glfw
+	return 0;
 }
 
 // callback function to handle resizing of the window
 void texFramebuffer_size_callback(GLFWwindow* window, int width, int height) {
-	glViewport(0, 0, width, height);
+	glState().viewport(0, 0, width, height);
 }
 
 void texProcessInput(GLFWwindow* window) {
@@ -186,4 +215,6 @@ void texProcessInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
 		MIX_AMT -= 0.01;
 	}
+	// mix() is only meaningful in [0, 1], and at 0 the container-only variant draws the same thing
+	MIX_AMT = std::min(1.0f, std::max(0.0f, MIX_AMT));
 }